@@ -4,35 +4,88 @@
 
 #include "bench.h"
 
+#include "tinyformat.h"
+
+#include <univalue.h>
+
+#include <algorithm>
 #include <iostream>
 #include <sys/time.h>
 
 using namespace benchmark;
 
-std::map<std::string, BenchFunction> BenchRunner::benchmarks;
-
 static double gettimedouble(void) {
     struct timeval tv;
     gettimeofday(&tv, NULL);
     return tv.tv_usec * 0.000001 + tv.tv_sec;
 }
 
+BenchRunner::BenchmarkMap& BenchRunner::benchmarks()
+{
+    // Constructed on first use: benchmarks register themselves from static
+    // initializers in other translation units.
+    static BenchmarkMap benchmarks_map;
+    return benchmarks_map;
+}
+
 BenchRunner::BenchRunner(std::string name, BenchFunction func)
 {
-    benchmarks.insert(std::make_pair(name, func));
+    Bench bench;
+    bench.func = func;
+    benchmarks().insert(std::make_pair(name, bench));
+}
+
+BenchRunner::BenchRunner(std::string name, BenchFunction func, int64_t nMin, int64_t nMax)
+{
+    Bench bench;
+    bench.func = func;
+    // the sizes grow by multiplying, a minimum below 1 would never get anywhere
+    for (int64_t n = std::max<int64_t>(nMin, 1); n < nMax; n *= 8)
+        bench.args.push_back(n);
+    bench.args.push_back(nMax);
+    benchmarks().insert(std::make_pair(name, bench));
 }
 
 void
-BenchRunner::RunAll(double elapsedTimeForOne)
+BenchRunner::RunAll(double elapsedTimeForOne, const std::string& strFilter, bool fJson)
 {
-    std::cout << "Benchmark" << "," << "count" << "," << "min" << "," << "max" << "," << "average" << "\n";
+    UniValue results(UniValue::VARR);
+    if (!fJson)
+        std::cout << "Benchmark" << "," << "count" << "," << "min" << "," << "max" << "," << "average" << "\n";
+
+    for (BenchmarkMap::iterator it = benchmarks().begin(); it != benchmarks().end(); ++it) {
+        if (it->first.find(strFilter) == std::string::npos)
+            continue;
+
+        // Benchmarks without a range run once with a size of 0
+        std::vector<int64_t> vArgs = it->second.args;
+        if (vArgs.empty())
+            vArgs.push_back(0);
 
-    for (std::map<std::string,BenchFunction>::iterator it = benchmarks.begin();
-         it != benchmarks.end(); ++it) {
+        for (size_t i = 0; i < vArgs.size(); i++) {
+            std::string strName = it->second.args.empty() ? it->first : strprintf("%s/%d", it->first, vArgs[i]);
+            State state(strName, vArgs[i], elapsedTimeForOne);
+            it->second.func(state);
+
+            if (fJson) {
+                UniValue result(UniValue::VOBJ);
+                result.push_back(Pair("name", it->first));
+                result.push_back(Pair("size", vArgs[i]));
+                result.push_back(Pair("count", state.GetCount()));
+                result.push_back(Pair("min", state.GetMinTime()));
+                result.push_back(Pair("max", state.GetMaxTime()));
+                result.push_back(Pair("average", state.GetAverageTime()));
+                results.push_back(result);
+            } else {
+                std::cout << strName << "," << state.GetCount() << "," << state.GetMinTime() << "," << state.GetMaxTime() << "," << state.GetAverageTime() << "\n";
+            }
+        }
+    }
 
-        State state(it->first, elapsedTimeForOne);
-        BenchFunction& func = it->second;
-        func(state);
+    if (fJson) {
+        UniValue doc(UniValue::VOBJ);
+        doc.push_back(Pair("benchmarks", results));
+        std::cout << doc.write(2) << "\n";
     }
 }
 
@@ -62,9 +115,8 @@ bool State::KeepRunning()
 
     --count;
 
-    // Output results
-    double average = (now-beginTime)/count;
-    std::cout << name << "," << count << "," << minTime << "," << maxTime << "," << average << "\n";
+    // Record results, BenchRunner::RunAll prints them
+    averageTime = (now-beginTime)/count;
 
     return false;
 }
@@ -5,8 +5,10 @@
 #ifndef BITCOIN_BENCH_BENCH_H
 #define BITCOIN_BENCH_BENCH_H
 
+#include <limits>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <boost/function.hpp>
 #include <boost/preprocessor/cat.hpp>
@@ -32,36 +34,60 @@ static void CODE_TO_TIME(benchmark::State& state)
 
 BENCHMARK(CODE_TO_TIME);
 
+ * Benchmarks that depend on an input size read it with state.range_x() and are
+ * registered with BENCHMARK_RANGE(CODE_TO_TIME, min, max), where min <= max.
+ * They are run once for min (at least 1), every power of 8 times that below max, and max,
+ * each reported as "CODE_TO_TIME/<size>".
  */
- 
+
 namespace benchmark {
 
     class State {
         std::string name;
+        int64_t arg;
         double maxElapsed;
         double beginTime;
-        double lastTime, minTime, maxTime;
+        double lastTime, minTime, maxTime, averageTime;
         int64_t count;
         int64_t timeCheckCount;
     public:
-        State(std::string _name, double _maxElapsed) : name(_name), maxElapsed(_maxElapsed), count(0) {
+        State(std::string _name, int64_t _arg, double _maxElapsed) : name(_name), arg(_arg), maxElapsed(_maxElapsed), averageTime(0), count(0) {
             minTime = std::numeric_limits<double>::max();
             maxTime = std::numeric_limits<double>::min();
             timeCheckCount = 1;
         }
         bool KeepRunning();
+
+        //! Input size this run was registered with, 0 for benchmarks without a range
+        int64_t range_x() const { return arg; }
+
+        const std::string& GetName() const { return name; }
+        int64_t GetCount() const { return count; }
+        double GetMinTime() const { return minTime; }
+        double GetMaxTime() const { return maxTime; }
+        double GetAverageTime() const { return averageTime; }
     };
 
     typedef boost::function<void(State&)> BenchFunction;
 
     class BenchRunner
     {
-        static std::map<std::string, BenchFunction> benchmarks;
+        struct Bench {
+            BenchFunction func;
+            std::vector<int64_t> args;
+        };
+        typedef std::map<std::string, Bench> BenchmarkMap;
+        static BenchmarkMap& benchmarks();
 
     public:
         BenchRunner(std::string name, BenchFunction func);
+        BenchRunner(std::string name, BenchFunction func, int64_t nMin, int64_t nMax);
 
-        static void RunAll(double elapsedTimeForOne=1.0);
+        /**
+         * Run every benchmark whose name contains strFilter and print the results
+         * as CSV, or as a JSON document when fJson is set.
+         */
+        static void RunAll(double elapsedTimeForOne=1.0, const std::string& strFilter="", bool fJson=false);
     };
 }
 
@@ -69,4 +95,8 @@ namespace benchmark {
 #define BENCHMARK(n) \
     benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n);
 
+// BENCHMARK_RANGE(foo, 8, 512) expands to:  benchmark::BenchRunner bench_11foo("foo", foo, 8, 512);
+#define BENCHMARK_RANGE(n, lo, hi) \
+    benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n, lo, hi);
+
 #endif // BITCOIN_BENCH_BENCH_H
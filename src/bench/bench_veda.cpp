@@ -4,18 +4,37 @@
 
 #include "bench.h"
 
+#include "chainparams.h"
 #include "key.h"
+#include "messagesigner.h"
+#include "script/sigcache.h"
 #include "validation.h"
 #include "util.h"
 
+#include <iostream>
+
 int
 main(int argc, char** argv)
 {
+    ParseParameters(argc, argv);
+
+    if (mapArgs.count("-?") || mapArgs.count("-h") || mapArgs.count("-help")) {
+        std::cout << "Usage: bench_veda [options]\n"
+                  << "  -filter=<str>   Only run benchmarks whose name contains <str>\n"
+                  << "  -time=<secs>    Time to spend on each benchmark and input size (default: 1)\n"
+                  << "  -printer=<fmt>  Output format, csv or json (default: csv)\n";
+        return 0;
+    }
+
     ECC_Start();
     SetupEnvironment();
     fPrintToDebugLog = false; // don't want to write to debug.log file
+    InitSignatureCache();
+    InitMessageSignatureCache();
+    SelectParams(CBaseChainParams::REGTEST);
 
-    benchmark::BenchRunner::RunAll();
+    double dElapsed = atof(GetArg("-time", "1").c_str());
+    benchmark::BenchRunner::RunAll(dElapsed > 0 ? dElapsed : 1.0, GetArg("-filter", ""), GetArg("-printer", "csv") == "json");
 
     ECC_Stop();
 }
@@ -0,0 +1,45 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "bloom.h"
+#include "random.h"
+
+#include <vector>
+
+static std::vector<uint256> MakeBenchHashes(size_t nCount)
+{
+    std::vector<uint256> vHashes(nCount);
+    for (size_t i = 0; i < nCount; i++)
+        vHashes[i] = GetRandHash();
+    return vHashes;
+}
+
+static void BloomFilterInsert(benchmark::State& state)
+{
+    std::vector<uint256> vHashes = MakeBenchHashes(state.range_x());
+    while (state.KeepRunning()) {
+        CBloomFilter filter(vHashes.size(), 0.0001, 0, BLOOM_UPDATE_ALL);
+        for (size_t i = 0; i < vHashes.size(); i++)
+            filter.insert(vHashes[i]);
+    }
+}
+
+// Half of the queried elements are in the filter
+static void BloomFilterMatch(benchmark::State& state)
+{
+    std::vector<uint256> vHashes = MakeBenchHashes(state.range_x());
+    CBloomFilter filter(vHashes.size(), 0.0001, 0, BLOOM_UPDATE_ALL);
+    for (size_t i = 0; i < vHashes.size(); i += 2)
+        filter.insert(vHashes[i]);
+    int nMatches = 0;
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < vHashes.size(); i++)
+            nMatches += filter.contains(vHashes[i]);
+    }
+}
+
+BENCHMARK_RANGE(BloomFilterInsert, 64, 100000);
+BENCHMARK_RANGE(BloomFilterMatch, 64, 100000);
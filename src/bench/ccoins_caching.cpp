@@ -0,0 +1,52 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "coins.h"
+#include "random.h"
+#include "script/script.h"
+
+#include <vector>
+
+static void AddBenchCoins(CCoinsViewCache& view, std::vector<COutPoint>& vOutpoints, size_t nCount)
+{
+    for (size_t i = 0; i < nCount; i++) {
+        COutPoint outpoint(GetRandHash(), 0);
+        CTxOut out(50000 + i, CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, i) << OP_EQUALVERIFY << OP_CHECKSIG);
+        view.AddCoin(outpoint, Coin(out, 1, false), false);
+        vOutpoints.push_back(outpoint);
+    }
+}
+
+// Pull every coin from a parent cache into a fresh child cache, as block
+// connection does with pcoinsTip
+static void CoinsCacheFetch(benchmark::State& state)
+{
+    CCoinsView viewDummy;
+    CCoinsViewCache viewBase(&viewDummy);
+    std::vector<COutPoint> vOutpoints;
+    AddBenchCoins(viewBase, vOutpoints, state.range_x());
+    while (state.KeepRunning()) {
+        CCoinsViewCache view(&viewBase);
+        for (size_t i = 0; i < vOutpoints.size(); i++)
+            view.AccessCoin(vOutpoints[i]);
+    }
+}
+
+// Create coins in a child cache and flush them into its parent
+static void CoinsCacheFlush(benchmark::State& state)
+{
+    CCoinsView viewDummy;
+    while (state.KeepRunning()) {
+        CCoinsViewCache viewBase(&viewDummy);
+        CCoinsViewCache view(&viewBase);
+        std::vector<COutPoint> vOutpoints;
+        AddBenchCoins(view, vOutpoints, state.range_x());
+        view.Flush();
+    }
+}
+
+BENCHMARK_RANGE(CoinsCacheFetch, 64, 100000);
+BENCHMARK_RANGE(CoinsCacheFlush, 64, 100000);
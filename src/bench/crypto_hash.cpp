@@ -0,0 +1,46 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "crypto/sha256.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "random.h"
+
+#include <vector>
+
+static CBlockHeader MakeBenchHeader()
+{
+    CBlockHeader header;
+    header.nVersion = 536870912;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.nTime = 1500000000;
+    header.nBits = 0x1b04864c;
+    return header;
+}
+
+// One 80-byte header at a time, as CBlockHeader::GetHash() does it
+static void HashX11Header(benchmark::State& state)
+{
+    CBlockHeader header = MakeBenchHeader();
+    uint256 hash;
+    while (state.KeepRunning()) {
+        header.nNonce++;
+        hash = header.GetHash();
+    }
+}
+
+static void SHA256Data(benchmark::State& state)
+{
+    std::vector<unsigned char> in(state.range_x(), 0);
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    while (state.KeepRunning()) {
+        CSHA256().Write(in.data(), in.size()).Finalize(hash);
+    }
+}
+
+BENCHMARK(HashX11Header);
+BENCHMARK_RANGE(SHA256Data, 64, 1000000);
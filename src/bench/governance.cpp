@@ -0,0 +1,180 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "bloom.h"
+#include "clientversion.h"
+#include "governance.h"
+#include "governance-object.h"
+#include "governance-vote.h"
+#include "governance-votedb.h"
+#include "masternode.h"
+#include "masternode-sync.h"
+#include "masternodeman.h"
+#include "net.h"
+#include "random.h"
+#include "streams.h"
+#include "utilstrencodings.h"
+
+#include <vector>
+
+// Votes from nMasternodes distinct masternodes on a single object
+static std::vector<CGovernanceVote> MakeBenchVotes(size_t nMasternodes)
+{
+    uint256 nParentHash = GetRandHash();
+    std::vector<CGovernanceVote> vVotes;
+    vVotes.reserve(nMasternodes);
+    for (size_t i = 0; i < nMasternodes; i++) {
+        CGovernanceVote vote(COutPoint(GetRandHash(), 0), nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+        vVotes.push_back(vote);
+    }
+    return vVotes;
+}
+
+// Record votes as CGovernanceObject::ProcessVote does after a vote was accepted
+static void GovernanceVoteFileAdd(benchmark::State& state)
+{
+    std::vector<CGovernanceVote> vVotes = MakeBenchVotes(state.range_x());
+    while (state.KeepRunning()) {
+        CGovernanceObjectVoteFile voteFile;
+        for (size_t i = 0; i < vVotes.size(); i++) {
+            if (!voteFile.HasVote(vVotes[i].GetHash()))
+                voteFile.AddVote(vVotes[i]);
+        }
+    }
+}
+
+// Drop one masternode's votes, as done for every object when a masternode leaves the list
+static void GovernanceVoteFileRemoveMasternode(benchmark::State& state)
+{
+    std::vector<CGovernanceVote> vVotes = MakeBenchVotes(state.range_x());
+    CGovernanceObjectVoteFile voteFile;
+    for (size_t i = 0; i < vVotes.size(); i++)
+        voteFile.AddVote(vVotes[i]);
+    COutPoint outpointMissing(GetRandHash(), 0);
+    while (state.KeepRunning()) {
+        voteFile.RemoveVotesFromMasternode(outpointMissing);
+    }
+}
+
+/**
+ * Keeps the masternode list, governance objects and sync state the benchmarks below
+ * replace, the other benchmarks run in the same process and get them back afterwards.
+ */
+class CGovernanceBenchState
+{
+private:
+    CDataStream ssMasternodes;
+    CDataStream ssGovernance;
+    CMasternodeSync masternodeSyncOld;
+
+public:
+    CGovernanceBenchState() : ssMasternodes(SER_DISK, CLIENT_VERSION), ssGovernance(SER_DISK, CLIENT_VERSION), masternodeSyncOld(masternodeSync)
+    {
+        ssMasternodes << mnodeman;
+        ssGovernance << governance;
+        mnodeman.Clear();
+        governance.Clear();
+    }
+
+    ~CGovernanceBenchState()
+    {
+        governance.Clear();
+        ssGovernance >> governance;
+        mnodeman.Clear();
+        ssMasternodes >> mnodeman;
+        masternodeSync = masternodeSyncOld;
+    }
+};
+
+// A proposal loaded into governance the way governance.dat is read, it has no collateral to be accepted otherwise
+static uint256 LoadBenchObject()
+{
+    std::string strData = HexStr(std::string("[[\"proposal\",{\"type\":1,\"name\":\"bench\"}]]"));
+    CGovernanceObject govobj(uint256(), 1, GetAdjustedTime(), GetRandHash(), strData);
+
+    std::string strVersion;
+    CGovernanceManager::hash_time_m_t mapErasedGovernanceObjects, mapWatchdogObjects;
+    CGovernanceManager::vote_cache_t mapInvalidVotes;
+    CGovernanceManager::vote_mcache_t mapOrphanVotes;
+    CGovernanceManager::object_m_t mapObjects;
+    uint256 nHashWatchdogCurrent;
+    int64_t nTimeWatchdogCurrent;
+    CGovernanceManager::txout_m_t mapLastMasternodeObject;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CGovernanceManager();
+    ss >> strVersion >> mapErasedGovernanceObjects >> mapInvalidVotes >> mapOrphanVotes >> mapObjects
+       >> mapWatchdogObjects >> nHashWatchdogCurrent >> nTimeWatchdogCurrent >> mapLastMasternodeObject;
+    mapObjects.insert(std::make_pair(govobj.GetHash(), govobj));
+    ss << strVersion << mapErasedGovernanceObjects << mapInvalidVotes << mapOrphanVotes << mapObjects
+       << mapWatchdogObjects << nHashWatchdogCurrent << nTimeWatchdogCurrent << mapLastMasternodeObject;
+    ss >> governance;
+    return govobj.GetHash();
+}
+
+// Signed votes from nMasternodes masternodes added to the list
+static std::vector<CGovernanceVote> MakeSignedBenchVotes(const uint256& nParentHash, size_t nMasternodes)
+{
+    std::vector<CGovernanceVote> vVotes;
+    vVotes.reserve(nMasternodes);
+    for (size_t i = 0; i < nMasternodes; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        CPubKey pubkey = key.GetPubKey();
+        CMasternode mn(CService(), COutPoint(GetRandHash(), 0), pubkey, pubkey, PROTOCOL_VERSION);
+        mnodeman.Add(mn);
+        CGovernanceVote vote(mn.vin.prevout, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+        vote.Sign(key, pubkey);
+        vVotes.push_back(vote);
+    }
+    return vVotes;
+}
+
+// Accept a vote of every masternode on one object through CGovernanceManager, as for votes from peers.
+// Only the first round verifies signatures, the later ones are served by the message signature cache.
+static void GovernanceProcessVote(benchmark::State& state)
+{
+    CGovernanceBenchState benchState;
+    CConnman connman;
+    uint256 nHash = LoadBenchObject();
+    std::vector<CGovernanceVote> vVotes = MakeSignedBenchVotes(nHash, state.range_x());
+    CGovernanceException exception;
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < vVotes.size(); i++)
+            governance.ProcessVoteAndRelay(vVotes[i], exception, connman);
+    }
+}
+
+// Announce an object and all its votes to a peer that has none of them
+static void GovernanceSync(benchmark::State& state)
+{
+    CGovernanceBenchState benchState;
+    CConnman connman;
+    uint256 nHash = LoadBenchObject();
+    std::vector<CGovernanceVote> vVotes = MakeSignedBenchVotes(nHash, state.range_x());
+    CGovernanceException exception;
+    for (size_t i = 0; i < vVotes.size(); i++)
+        governance.ProcessVoteAndRelay(vVotes[i], exception, connman);
+
+    // nothing is handed out before the node is synced
+    while (!masternodeSync.IsSynced())
+        masternodeSync.SwitchToNextAsset(connman);
+
+    // without a socket the sync status messages are dropped, only the inventory is built up
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, CAddress(CService(), NODE_NONE), "", true);
+    node.SetSendVersion(PROTOCOL_VERSION);
+    CBloomFilter filter(1, 0.01, 0, BLOOM_UPDATE_NONE);
+    while (state.KeepRunning()) {
+        governance.Sync(&node, nHash, filter, connman);
+        LOCK(node.cs_inventory);
+        node.vInventoryToSend.clear();
+    }
+}
+
+BENCHMARK_RANGE(GovernanceVoteFileAdd, 64, 5000);
+BENCHMARK_RANGE(GovernanceVoteFileRemoveMasternode, 64, 5000);
+BENCHMARK_RANGE(GovernanceProcessVote, 64, 5000);
+BENCHMARK_RANGE(GovernanceSync, 64, 5000);
@@ -0,0 +1,81 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "chain.h"
+#include "clientversion.h"
+#include "masternode.h"
+#include "masternode-sync.h"
+#include "masternodeman.h"
+#include "net.h"
+#include "random.h"
+#include "streams.h"
+#include "validation.h"
+
+#include <vector>
+
+// Score a single masternode against a block hash
+static void MasternodeCalculateScore(benchmark::State& state)
+{
+    CMasternode mn(CService(), COutPoint(GetRandHash(), 0), CPubKey(), CPubKey(), PROTOCOL_VERSION);
+    uint256 blockHash = GetRandHash();
+    arith_uint256 score;
+    while (state.KeepRunning()) {
+        score = mn.CalculateScore(blockHash);
+    }
+}
+
+// Rank the masternode list through CMasternodeMan::GetMasternodeRanks, for a different block every time
+static void MasternodeRankList(benchmark::State& state)
+{
+    // more blocks than CMasternodeMan keeps rank tables for, so no call is served from that cache
+    std::vector<uint256> vBlockHashes(256);
+    std::vector<CBlockIndex> vBlocks(vBlockHashes.size());
+    for (size_t i = 0; i < vBlocks.size(); i++) {
+        vBlockHashes[i] = GetRandHash();
+        vBlocks[i].phashBlock = &vBlockHashes[i];
+        vBlocks[i].nHeight = i;
+        vBlocks[i].pprev = i > 0 ? &vBlocks[i - 1] : NULL;
+    }
+
+    // the other benchmarks run in the same process, they get the chain, sync state and list back afterwards
+    CBlockIndex* pindexTipOld;
+    {
+        LOCK(cs_main);
+        pindexTipOld = chainActive.Tip();
+        chainActive.SetTip(&vBlocks.back());
+    }
+    CMasternodeSync masternodeSyncOld = masternodeSync;
+    CDataStream ssMasternodes(SER_DISK, CLIENT_VERSION);
+    ssMasternodes << mnodeman;
+
+    // ranks are only handed out once the list is synced
+    CConnman connman;
+    while (!masternodeSync.IsMasternodeListSynced())
+        masternodeSync.SwitchToNextAsset(connman);
+
+    mnodeman.Clear();
+    for (int64_t i = 0; i < state.range_x(); i++) {
+        CMasternode mn(CService(), COutPoint(GetRandHash(), 0), CPubKey(), CPubKey(), PROTOCOL_VERSION);
+        mnodeman.Add(mn);
+    }
+
+    CMasternodeMan::rank_pair_vec_t vecMasternodeRanks;
+    size_t nHeight = 0;
+    while (state.KeepRunning()) {
+        mnodeman.GetMasternodeRanks(vecMasternodeRanks, nHeight);
+        nHeight = (nHeight + 1) % vBlocks.size();
+    }
+
+    mnodeman.Clear();
+    ssMasternodes >> mnodeman;
+    masternodeSync = masternodeSyncOld;
+    LOCK(cs_main);
+    chainActive.SetTip(pindexTipOld);
+}
+
+BENCHMARK(MasternodeCalculateScore);
+BENCHMARK_RANGE(MasternodeRankList, 64, 5000);
@@ -0,0 +1,76 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "primitives/block.h"
+#include "random.h"
+#include "script/script.h"
+#include "streams.h"
+#include "version.h"
+
+static CMutableTransaction MakeBenchTransaction(size_t nInputs, size_t nOutputs)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(nInputs);
+    for (size_t i = 0; i < nInputs; i++) {
+        tx.vin[i].prevout = COutPoint(GetRandHash(), i);
+        // Typical P2PKH scriptSig: signature plus compressed pubkey
+        tx.vin[i].scriptSig = CScript() << std::vector<unsigned char>(72, 0x30) << std::vector<unsigned char>(33, 0x02);
+    }
+    tx.vout.resize(nOutputs);
+    for (size_t i = 0; i < nOutputs; i++) {
+        tx.vout[i].nValue = 1000 + i;
+        tx.vout[i].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, i) << OP_EQUALVERIFY << OP_CHECKSIG;
+    }
+    return tx;
+}
+
+static CBlock MakeBenchBlock(size_t nTransactions)
+{
+    CBlock block;
+    block.nVersion = 536870912;
+    block.hashPrevBlock = GetRandHash();
+    block.nTime = 1500000000;
+    block.nBits = 0x1b04864c;
+    for (size_t i = 0; i < nTransactions; i++)
+        block.vtx.push_back(MakeBenchTransaction(2, 2));
+    return block;
+}
+
+static void SerializeBlock(benchmark::State& state)
+{
+    CBlock block = MakeBenchBlock(state.range_x());
+    while (state.KeepRunning()) {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << block;
+    }
+}
+
+static void DeserializeBlock(benchmark::State& state)
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << MakeBenchBlock(state.range_x());
+    while (state.KeepRunning()) {
+        CDataStream copy(stream);
+        CBlock block;
+        copy >> block;
+    }
+}
+
+// Deserializing also computes the transaction hash
+static void DeserializeTransaction(benchmark::State& state)
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << CTransaction(MakeBenchTransaction(state.range_x(), 2));
+    while (state.KeepRunning()) {
+        CDataStream copy(stream);
+        CTransaction tx;
+        copy >> tx;
+    }
+}
+
+BENCHMARK_RANGE(SerializeBlock, 1, 4000);
+BENCHMARK_RANGE(DeserializeBlock, 1, 4000);
+BENCHMARK_RANGE(DeserializeTransaction, 1, 512);
@@ -0,0 +1,148 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "coins.h"
+#include "consensus/validation.h"
+#include "key.h"
+#include "keystore.h"
+#include "policy/policy.h"
+#include "pubkey.h"
+#include "random.h"
+#include "script/sigcache.h"
+#include "script/sign.h"
+#include "script/standard.h"
+#include "txmempool.h"
+#include "validation.h"
+
+#include <vector>
+
+static const ECCVerifyHandle benchVerifyHandle;
+
+/**
+ * Minimal chain state for transaction validation benchmarks: a single block
+ * index at height 0 as the tip, and a coins view holding nInputs P2PKH coins
+ * together with a signed transaction spending all of them.
+ */
+class CBenchTxSetup
+{
+private:
+    CCoinsView viewDummy;
+    uint256 hashTip;
+    CBlockIndex indexTip;
+
+public:
+    CCoinsViewCache view;
+    CMutableTransaction tx;
+
+    CBenchTxSetup(size_t nInputs) : view(&viewDummy)
+    {
+        LOCK(cs_main);
+        hashTip = GetRandHash();
+        indexTip.phashBlock = &hashTip;
+        indexTip.nHeight = 0;
+        mapBlockIndex.insert(std::make_pair(hashTip, &indexTip));
+        chainActive.SetTip(&indexTip);
+        view.SetBestBlock(hashTip);
+
+        CBasicKeyStore keystore;
+        CKey key;
+        key.MakeNewKey(true);
+        keystore.AddKey(key);
+        CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+
+        tx.vin.resize(nInputs);
+        for (size_t i = 0; i < nInputs; i++) {
+            tx.vin[i].prevout = COutPoint(GetRandHash(), 0);
+            view.AddCoin(tx.vin[i].prevout, Coin(CTxOut(COIN, scriptPubKey), 0, false), false);
+        }
+        tx.vout.resize(1);
+        tx.vout[0].nValue = nInputs * COIN - CENT;
+        tx.vout[0].scriptPubKey = scriptPubKey;
+        for (size_t i = 0; i < nInputs; i++)
+            SignSignature(keystore, scriptPubKey, tx, i);
+
+        pcoinsTip = &view;
+    }
+
+    ~CBenchTxSetup()
+    {
+        LOCK(cs_main);
+        pcoinsTip = NULL;
+        chainActive.SetTip(NULL);
+        mapBlockIndex.erase(hashTip);
+    }
+};
+
+// Full input checks, with every signature actually verified
+static void CheckInputsNoCache(benchmark::State& state)
+{
+    CBenchTxSetup setup(state.range_x());
+    CTransaction tx(setup.tx);
+    while (state.KeepRunning()) {
+        CValidationState validationState;
+        bool fValid = CheckInputs(tx, validationState, setup.view, true, STANDARD_SCRIPT_VERIFY_FLAGS, false);
+        assert(fValid);
+    }
+}
+
+// Input checks where every signature is already in the signature cache,
+// as when a block contains transactions we accepted to the mempool
+static void CheckInputsCached(benchmark::State& state)
+{
+    CBenchTxSetup setup(state.range_x());
+    CTransaction tx(setup.tx);
+    CValidationState validationStateWarm;
+    assert(CheckInputs(tx, validationStateWarm, setup.view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true));
+    while (state.KeepRunning()) {
+        CValidationState validationState;
+        bool fValid = CheckInputs(tx, validationState, setup.view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true);
+        assert(fValid);
+    }
+}
+
+// A single signature cache lookup that hits
+static void SigCacheLookup(benchmark::State& state)
+{
+    CBenchTxSetup setup(1);
+    CTransaction tx(setup.tx);
+    const CScript& scriptSig = tx.vin[0].scriptSig;
+    CScript::const_iterator pc = scriptSig.begin();
+    opcodetype opcode;
+    std::vector<unsigned char> vchSig, vchPubKey;
+    scriptSig.GetOp(pc, opcode, vchSig);
+    scriptSig.GetOp(pc, opcode, vchPubKey);
+    vchSig.pop_back(); // drop the hash type
+    CPubKey pubkey(vchPubKey);
+    uint256 sighash = SignatureHash(setup.view.AccessCoin(tx.vin[0].prevout).out.scriptPubKey, tx, 0, SIGHASH_ALL);
+
+    CachingTransactionSignatureChecker checker(&tx, 0, true);
+    assert(checker.VerifySignature(vchSig, pubkey, sighash));
+    while (state.KeepRunning()) {
+        bool fValid = checker.VerifySignature(vchSig, pubkey, sighash);
+        assert(fValid);
+    }
+}
+
+// Accept the transaction into an empty mempool. Signatures are cached after
+// the first round, so this measures the policy and bookkeeping around them.
+static void MempoolAccept(benchmark::State& state)
+{
+    CBenchTxSetup setup(state.range_x());
+    CTransaction tx(setup.tx);
+    CTxMemPool pool(CFeeRate(0));
+    while (state.KeepRunning()) {
+        LOCK(cs_main);
+        CValidationState validationState;
+        bool fAccepted = AcceptToMemoryPool(pool, validationState, tx, false, NULL);
+        assert(fAccepted);
+        pool.clear();
+    }
+}
+
+BENCHMARK_RANGE(CheckInputsNoCache, 1, 64);
+BENCHMARK_RANGE(CheckInputsCached, 1, 64);
+BENCHMARK(SigCacheLookup);
+BENCHMARK_RANGE(MempoolAccept, 1, 64);
@@ -8,7 +8,10 @@
 #include <algorithm>
 #include <vector>
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
@@ -127,6 +130,9 @@ private:
     }
 
 public:
+    //! Mutex to ensure only one concurrent CCheckQueueControl
+    boost::mutex ControlMutex;
+
     //! Create a new check queue
     CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
 
@@ -157,6 +163,16 @@ public:
             condWorker.notify_all();
     }
 
+    //! Add a batch of checks of another type, each one is moved into a T
+    template <typename U>
+    void Add(std::vector<U>& vChecks)
+    {
+        std::vector<T> vConverted(vChecks.size());
+        for (unsigned int i = 0; i < vChecks.size(); i++)
+            T(vChecks[i]).swap(vConverted[i]);
+        Add(vConverted);
+    }
+
     ~CCheckQueue()
     {
     }
@@ -185,6 +201,7 @@ public:
     {
         // passed queue is supposed to be unused, or NULL
         if (pqueue != NULL) {
+            pqueue->ControlMutex.lock();
             bool isIdle = pqueue->IsIdle();
             assert(isIdle);
         }
@@ -199,7 +216,8 @@ public:
         return fRet;
     }
 
-    void Add(std::vector<T>& vChecks)
+    template <typename U>
+    void Add(std::vector<U>& vChecks)
     {
         if (pqueue != NULL)
             pqueue->Add(vChecks);
@@ -209,7 +227,65 @@ public:
     {
         if (!fDone)
             Wait();
+        if (pqueue != NULL)
+            pqueue->ControlMutex.unlock();
+    }
+};
+
+/**
+ * A check of any type, so checks of different kinds can share one CCheckQueue
+ * and with it one pool of worker threads. The wrapped check is moved to the heap.
+ */
+class CAnyCheck
+{
+private:
+    boost::function<bool()> check;
+
+public:
+    CAnyCheck() {}
+
+    template <typename U>
+    explicit CAnyCheck(U& checkIn)
+    {
+        boost::shared_ptr<U> pcheck(new U());
+        pcheck->swap(checkIn);
+        check = boost::bind(&U::operator(), pcheck);
+    }
+
+    bool operator()()
+    {
+        return check();
+    }
+
+    void swap(CAnyCheck& checkIn)
+    {
+        check.swap(checkIn.check);
     }
 };
 
+/**
+ * Run a batch of checks, spread over the worker threads of a shared queue when
+ * no one else is using it and on the calling thread otherwise. Waiting for
+ * another caller's batch would gain nothing as its threads are busy, and this
+ * cannot deadlock when called below another caller's CCheckQueueControl.
+ * Returns whether all checks succeeded.
+ */
+template <typename T, typename U>
+bool RunSharedChecks(CCheckQueue<T>* pqueue, std::vector<U>& vChecks)
+{
+    if (pqueue != NULL && vChecks.size() > 1) {
+        boost::unique_lock<boost::mutex> lock(pqueue->ControlMutex, boost::try_to_lock);
+        if (lock.owns_lock()) {
+            bool isIdle = pqueue->IsIdle();
+            assert(isIdle);
+            pqueue->Add(vChecks);
+            return pqueue->Wait();
+        }
+    }
+    bool fAllOk = true;
+    BOOST_FOREACH (U& check, vChecks)
+        fAllOk = check() && fAllOk;
+    return fAllOk;
+}
+
 #endif // BITCOIN_CHECKQUEUE_H
@@ -19,6 +19,8 @@
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
+//! Files LevelDB may keep open per database
+static const int DBWRAPPER_MAX_OPEN_FILES = 64;
 
 class dbwrapper_error : public std::runtime_error
 {
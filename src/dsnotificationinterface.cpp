@@ -53,8 +53,14 @@ void CDSNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, con
     governance.UpdatedBlockTip(pindexNew, connman);
 }
 
-void CDSNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+void CDSNotificationInterface::BlockConnected(const CBlock &block, const CBlockIndex *pindex)
 {
-    instantsend.SyncTransaction(tx, pblock);
-    CPrivateSend::SyncTransaction(tx, pblock);
+    instantsend.BlockConnected(block, pindex);
+    CPrivateSend::BlockConnected(block, pindex);
+}
+
+void CDSNotificationInterface::BlockDisconnected(const CBlock &block)
+{
+    instantsend.BlockDisconnected(block);
+    CPrivateSend::BlockDisconnected(block);
 }
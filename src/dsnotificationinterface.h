@@ -21,7 +21,8 @@ protected:
     void AcceptedBlockHeader(const CBlockIndex *pindexNew) override;
     void NotifyHeaderTip(const CBlockIndex *pindexNew, bool fInitialDownload) override;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
-    void SyncTransaction(const CTransaction &tx, const CBlock *pblock) override;
+    void BlockConnected(const CBlock &block, const CBlockIndex *pindex) override;
+    void BlockDisconnected(const CBlock &block) override;
 
 private:
     CConnman& connman;
@@ -0,0 +1,83 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef EXPIRYWHEEL_H_
+#define EXPIRYWHEEL_H_
+
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * Keys of some container ordered by the time they expire at, in buckets of
+ * nBucketWidth. Cleaning up the container then only touches the buckets that
+ * are due instead of walking every entry.
+ *
+ * The wheel doesn't see the container being changed, so a key handed out by
+ * PopExpired may be gone already or may have been given a later expiry time.
+ * Callers look the entry up again and Add it back if it is still alive.
+ */
+template<typename K>
+class CExpiryWheel
+{
+public:
+    typedef std::map<int64_t, std::vector<K> > bucket_map_t;
+
+private:
+    int64_t nBucketWidth;
+
+    bucket_map_t mapBuckets;
+
+    size_t nSize;
+
+    int64_t GetBucket(int64_t nTime) const
+    {
+        return nTime / nBucketWidth;
+    }
+
+public:
+    CExpiryWheel(int64_t nBucketWidthIn)
+        : nBucketWidth(nBucketWidthIn),
+          mapBuckets(),
+          nSize(0)
+    {}
+
+    void Add(const K& key, int64_t nExpiryTime)
+    {
+        mapBuckets[GetBucket(nExpiryTime)].push_back(key);
+        ++nSize;
+    }
+
+    /**
+     * Take out the keys of every bucket that starts at or before nTime. That is
+     * every key expiring at or before nTime, plus the keys sharing nTime's
+     * bucket that expire up to nBucketWidth - 1 later; callers re-check those
+     * and Add them back.
+     */
+    void PopExpired(int64_t nTime, std::vector<K>& vecKeysRet)
+    {
+        int64_t nLastBucket = GetBucket(nTime);
+        typename bucket_map_t::iterator it = mapBuckets.begin();
+        while(it != mapBuckets.end() && it->first <= nLastBucket) {
+            vecKeysRet.insert(vecKeysRet.end(), it->second.begin(), it->second.end());
+            nSize -= it->second.size();
+            mapBuckets.erase(it++);
+        }
+    }
+
+    void Clear()
+    {
+        mapBuckets.clear();
+        nSize = 0;
+    }
+
+    /// Number of keys in the wheel, including ones whose entries are gone already
+    size_t GetSize() const
+    {
+        return nSize;
+    }
+};
+
+#endif /* EXPIRYWHEEL_H_ */
@@ -36,6 +36,7 @@ CGovernanceObject::CGovernanceObject()
   fExpired(false),
   fUnparsable(false),
   mapCurrentMNVotes(),
+  mapVoteCounts(),
   mapOrphanVotes(),
   fileVotes()
 {
@@ -64,6 +65,7 @@ CGovernanceObject::CGovernanceObject(uint256 nHashParentIn, int nRevisionIn, int
   fExpired(false),
   fUnparsable(false),
   mapCurrentMNVotes(),
+  mapVoteCounts(),
   mapOrphanVotes(),
   fileVotes()
 {
@@ -92,6 +94,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other)
   fExpired(other.fExpired),
   fUnparsable(other.fUnparsable),
   mapCurrentMNVotes(other.mapCurrentMNVotes),
+  mapVoteCounts(other.mapVoteCounts),
   mapOrphanVotes(other.mapOrphanVotes),
   fileVotes(other.fileVotes)
 {}
@@ -140,6 +143,7 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
     vote_instance_m_it it2 = recVote.mapInstances.find(int(eSignal));
     if(it2 == recVote.mapInstances.end()) {
         it2 = recVote.mapInstances.insert(vote_instance_m_t::value_type(int(eSignal), vote_instance_t())).first;
+        AdjustVoteCount(eSignal, VOTE_OUTCOME_NONE, 1);
     }
     vote_instance_t& voteInstance = it2->second;
 
@@ -189,7 +193,9 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         exception = CGovernanceException(ostr.str(), GOVERNANCE_EXCEPTION_PERMANENT_ERROR);
         return false;
     }
+    AdjustVoteCount(eSignal, voteInstance.eOutcome, -1);
     voteInstance = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
+    AdjustVoteCount(eSignal, voteInstance.eOutcome, 1);
     if(!fileVotes.HasVote(vote.GetHash())) {
         fileVotes.AddVote(vote);
     }
@@ -203,6 +209,9 @@ void CGovernanceObject::ClearMasternodeVotes()
     while(it != mapCurrentMNVotes.end()) {
         if(!mnodeman.Has(it->first)) {
             fileVotes.RemoveVotesFromMasternode(it->first);
+            for(vote_instance_m_cit it2 = it->second.mapInstances.begin(); it2 != it->second.mapInstances.end(); ++it2) {
+                AdjustVoteCount(it2->first, it2->second.eOutcome, -1);
+            }
             mapCurrentMNVotes.erase(it++);
         }
         else {
@@ -211,6 +220,26 @@ void CGovernanceObject::ClearMasternodeVotes()
     }
 }
 
+void CGovernanceObject::AdjustVoteCount(int nSignal, int nOutcome, int nDelta)
+{
+    vote_count_m_t::iterator it = mapVoteCounts.insert(vote_count_m_t::value_type(std::make_pair(nSignal, nOutcome), 0)).first;
+    it->second += nDelta;
+    if(it->second <= 0) {
+        mapVoteCounts.erase(it);
+    }
+}
+
+void CGovernanceObject::RebuildVoteCounts()
+{
+    mapVoteCounts.clear();
+    for(vote_m_cit it = mapCurrentMNVotes.begin(); it != mapCurrentMNVotes.end(); ++it) {
+        const vote_rec_t& recVote = it->second;
+        for(vote_instance_m_cit it2 = recVote.mapInstances.begin(); it2 != recVote.mapInstances.end(); ++it2) {
+            AdjustVoteCount(it2->first, it2->second.eOutcome, 1);
+        }
+    }
+}
+
 std::string CGovernanceObject::GetSignatureMessage() const
 {
     LOCK(cs);
@@ -596,19 +625,11 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingC
 
 int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
 {
-    int nCount = 0;
-    for(vote_m_cit it = mapCurrentMNVotes.begin(); it != mapCurrentMNVotes.end(); ++it) {
-        const vote_rec_t& recVote = it->second;
-        vote_instance_m_cit it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if(it2 == recVote.mapInstances.end()) {
-            continue;
-        }
-        const vote_instance_t& voteInstance = it2->second;
-        if(voteInstance.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
-        }
+    vote_count_m_t::const_iterator it = mapVoteCounts.find(std::make_pair(int(eVoteSignalIn), int(eVoteOutcomeIn)));
+    if(it == mapVoteCounts.end()) {
+        return 0;
     }
-    return nCount;
+    return it->second;
 }
 
 /**
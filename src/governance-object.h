@@ -124,6 +124,9 @@ public: // Types
 
     typedef CacheMultiMap<COutPoint, vote_time_pair_t> vote_mcache_t;
 
+    /// (signal, outcome) -> number of vote instances in mapCurrentMNVotes
+    typedef std::map<std::pair<int, int>, int> vote_count_m_t;
+
 private:
     /// critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -184,6 +187,9 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    /// Running tally of mapCurrentMNVotes, kept in step by ProcessVote and ClearMasternodeVotes
+    vote_count_m_t mapVoteCounts;
+
     /// Limited map of votes orphaned by MN
     vote_mcache_t mapOrphanVotes;
 
@@ -323,6 +329,9 @@ public:
             READWRITE(nDeletionTime);
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
+            if(ser_action.ForRead()) {
+                RebuildVoteCounts();
+            }
             READWRITE(fileVotes);
             LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
         }
@@ -349,6 +358,10 @@ private:
     /// Called when MN's which have voted on this object have been removed
     void ClearMasternodeVotes();
 
+    void AdjustVoteCount(int nSignal, int nOutcome, int nDelta);
+
+    void RebuildVoteCounts();
+
     void CheckOrphanVotes(CConnman& connman);
 
 };
@@ -7,13 +7,15 @@
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile()
     : nMemoryVotes(0),
       listVotes(),
-      mapVoteIndex()
+      mapVoteIndex(),
+      mapMasternodeVoteIndex()
 {}
 
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other)
     : nMemoryVotes(other.nMemoryVotes),
       listVotes(other.listVotes),
-      mapVoteIndex()
+      mapVoteIndex(),
+      mapMasternodeVoteIndex()
 {
     RebuildIndex();
 }
@@ -22,6 +24,7 @@ void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
 {
     listVotes.push_front(vote);
     mapVoteIndex[vote.GetHash()] = listVotes.begin();
+    mapMasternodeVoteIndex.insert(vote_mn_m_t::value_type(vote.GetMasternodeOutpoint(), listVotes.begin()));
     ++nMemoryVotes;
 }
 
@@ -53,19 +56,35 @@ std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
     return vecResult;
 }
 
+std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotesAfter(const uint256& nHashAfter, size_t nMaxVotes) const
+{
+    std::vector<CGovernanceVote> vecResult;
+    vote_m_cit it = nHashAfter.IsNull() ? mapVoteIndex.begin() : mapVoteIndex.upper_bound(nHashAfter);
+    for(; it != mapVoteIndex.end() && vecResult.size() < nMaxVotes; ++it) {
+        vecResult.push_back(*(it->second));
+    }
+    return vecResult;
+}
+
+std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotesByMasternode(const COutPoint& outpointMasternode) const
+{
+    std::vector<CGovernanceVote> vecResult;
+    std::pair<vote_mn_m_cit, vote_mn_m_cit> range = mapMasternodeVoteIndex.equal_range(outpointMasternode);
+    for(vote_mn_m_cit it = range.first; it != range.second; ++it) {
+        vecResult.push_back(*(it->second));
+    }
+    return vecResult;
+}
+
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
-    vote_l_it it = listVotes.begin();
-    while(it != listVotes.end()) {
-        if(it->GetMasternodeOutpoint() == outpointMasternode) {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
-        }
-        else {
-            ++it;
-        }
+    std::pair<vote_mn_m_it, vote_mn_m_it> range = mapMasternodeVoteIndex.equal_range(outpointMasternode);
+    for(vote_mn_m_it it = range.first; it != range.second; ++it) {
+        --nMemoryVotes;
+        mapVoteIndex.erase(it->second->GetHash());
+        listVotes.erase(it->second);
     }
+    mapMasternodeVoteIndex.erase(range.first, range.second);
 }
 
 CGovernanceObjectVoteFile& CGovernanceObjectVoteFile::operator=(const CGovernanceObjectVoteFile& other)
@@ -79,6 +98,7 @@ CGovernanceObjectVoteFile& CGovernanceObjectVoteFile::operator=(const CGovernanc
 void CGovernanceObjectVoteFile::RebuildIndex()
 {
     mapVoteIndex.clear();
+    mapMasternodeVoteIndex.clear();
     nMemoryVotes = 0;
     vote_l_it it = listVotes.begin();
     while(it != listVotes.end()) {
@@ -86,6 +106,7 @@ void CGovernanceObjectVoteFile::RebuildIndex()
         uint256 nHash = vote.GetHash();
         if(mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
             mapVoteIndex[nHash] = it;
+            mapMasternodeVoteIndex.insert(vote_mn_m_t::value_type(vote.GetMasternodeOutpoint(), it));
             ++nMemoryVotes;
             ++it;
         }
@@ -35,6 +35,12 @@ public: // Types
 
     typedef vote_m_t::const_iterator vote_m_cit;
 
+    typedef std::multimap<COutPoint,vote_l_it> vote_mn_m_t;
+
+    typedef vote_mn_m_t::iterator vote_mn_m_it;
+
+    typedef vote_mn_m_t::const_iterator vote_mn_m_cit;
+
 private:
     static const int MAX_MEMORY_VOTES = -1;
 
@@ -44,6 +50,9 @@ private:
 
     vote_m_t mapVoteIndex;
 
+    /// Votes in listVotes by masternode outpoint
+    vote_mn_m_t mapMasternodeVoteIndex;
+
 public:
     CGovernanceObjectVoteFile();
 
@@ -70,6 +79,17 @@ public:
 
     std::vector<CGovernanceVote> GetVotes() const;
 
+    /**
+     * Retrieve up to nMaxVotes votes cached in memory, ordered by vote hash and
+     * starting after nHashAfter (from the first vote if nHashAfter is null)
+     */
+    std::vector<CGovernanceVote> GetVotesAfter(const uint256& nHashAfter, size_t nMaxVotes) const;
+
+    /**
+     * Retrieve the votes cached in memory which were cast by the given masternode
+     */
+    std::vector<CGovernanceVote> GetVotesByMasternode(const COutPoint& outpointMasternode) const;
+
     CGovernanceObjectVoteFile& operator=(const CGovernanceObjectVoteFile& other);
 
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
@@ -132,6 +132,8 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, std::string& strCommand, C
             if(netfulfilledman.HasFulfilledRequest(pfrom->addr, NetMsgType::MNGOVERNANCESYNC)) {
                 // Asking for the whole list multiple times in a short period of time is no good
                 LogPrint("gobject", "MNGOVERNANCESYNC -- peer already asked me for the list\n");
+                // this may run on a special message worker, node states are only safe to change under cs_main
+                LOCK(cs_main);
                 Misbehaving(pfrom->GetId(), 20);
                 return;
             }
@@ -153,7 +155,7 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, std::string& strCommand, C
 
         uint256 nHash = govobj.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        pfrom->RemoveAskFor(nHash);
 
         if(!masternodeSync.IsMasternodeListSynced()) {
             LogPrint("gobject", "MNGOVERNANCEOBJECT -- masternode list not synced\n");
@@ -237,7 +239,7 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, std::string& strCommand, C
 
         uint256 nHash = vote.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        pfrom->RemoveAskFor(nHash);
 
         // Ignore such messages until masternode list is synced
         if(!masternodeSync.IsMasternodeListSynced()) {
@@ -264,6 +266,7 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, std::string& strCommand, C
         else {
             LogPrint("gobject", "MNGOVERNANCEOBJECTVOTE -- Rejected vote, error = %s\n", exception.what());
             if((exception.GetNodePenalty() != 0) && masternodeSync.IsSynced()) {
+                LOCK(cs_main);
                 Misbehaving(pfrom->GetId(), exception.GetNodePenalty());
             }
             return;
@@ -592,15 +595,19 @@ std::vector<CGovernanceVote> CGovernanceManager::GetCurrentVotes(const uint256&
     CGovernanceObject& govobj = it->second;
 
     CMasternode mn;
-    std::map<COutPoint, CMasternode> mapMasternodes;
+    CMasternodeMan::masternode_map_snapshot_t pMasternodes;
     if(mnCollateralOutpointFilter == COutPoint()) {
-        mapMasternodes = mnodeman.GetFullMasternodeMap();
-    } else if (mnodeman.Get(mnCollateralOutpointFilter, mn)) {
-        mapMasternodes[mnCollateralOutpointFilter] = mn;
+        pMasternodes = mnodeman.GetMasternodeListSnapshot();
+    } else {
+        CMasternodeMan::masternode_map_t mapFiltered;
+        if (mnodeman.Get(mnCollateralOutpointFilter, mn)) {
+            mapFiltered[mnCollateralOutpointFilter] = mn;
+        }
+        pMasternodes = std::make_shared<CMasternodeMan::masternode_map_t>(mapFiltered);
     }
 
     // Loop thru each MN collateral outpoint and get the votes for the `nParentHash` governance object
-    for (auto& mnpair : mapMasternodes)
+    for (const auto& mnpair : *pMasternodes)
     {
         // get a vote_rec_t from the govobj
         vote_rec_t voteRecord;
@@ -621,6 +628,19 @@ std::vector<CGovernanceVote> CGovernanceManager::GetCurrentVotes(const uint256&
     return vecResult;
 }
 
+std::vector<CGovernanceVote> CGovernanceManager::GetMasternodeVotes(const COutPoint& mnCollateralOutpoint)
+{
+    LOCK(cs);
+    std::vector<CGovernanceVote> vecResult;
+
+    for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
+        std::vector<CGovernanceVote> vecVotes = it->second.GetVoteFile().GetVotesByMasternode(mnCollateralOutpoint);
+        vecResult.insert(vecResult.end(), vecVotes.begin(), vecVotes.end());
+    }
+
+    return vecResult;
+}
+
 std::vector<CGovernanceObject*> CGovernanceManager::GetAllNewerThan(int64_t nMoreThanTime)
 {
     LOCK(cs);
@@ -749,30 +769,32 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
 
     LogPrint("gobject", "CGovernanceManager::Sync -- syncing to peer=%d, nProp = %s\n", pfrom->id, nProp.ToString());
 
-    {
-        LOCK2(cs_main, cs);
-
-        if(nProp == uint256()) {
-            // all valid objects, no votes
-            for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
-                CGovernanceObject& govobj = it->second;
-                std::string strHash = it->first.ToString();
+    if(nProp == uint256()) {
+        LOCK(cs);
 
-                LogPrint("gobject", "CGovernanceManager::Sync -- attempting to sync govobj: %s, peer=%d\n", strHash, pfrom->id);
+        // all valid objects, no votes
+        for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
+            CGovernanceObject& govobj = it->second;
+            std::string strHash = it->first.ToString();
 
-                if(govobj.IsSetCachedDelete() || govobj.IsSetExpired()) {
-                    LogPrintf("CGovernanceManager::Sync -- not syncing deleted/expired govobj: %s, peer=%d\n",
-                              strHash, pfrom->id);
-                    continue;
-                }
+            LogPrint("gobject", "CGovernanceManager::Sync -- attempting to sync govobj: %s, peer=%d\n", strHash, pfrom->id);
 
-                // Push the inventory budget proposal message over to the other client
-                LogPrint("gobject", "CGovernanceManager::Sync -- syncing govobj: %s, peer=%d\n", strHash, pfrom->id);
-                pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
-                ++nObjCount;
+            if(govobj.IsSetCachedDelete() || govobj.IsSetExpired()) {
+                LogPrintf("CGovernanceManager::Sync -- not syncing deleted/expired govobj: %s, peer=%d\n",
+                          strHash, pfrom->id);
+                continue;
             }
-        } else {
-            // single valid object and its valid votes
+
+            // Push the inventory budget proposal message over to the other client
+            LogPrint("gobject", "CGovernanceManager::Sync -- syncing govobj: %s, peer=%d\n", strHash, pfrom->id);
+            pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
+            ++nObjCount;
+        }
+    } else {
+        // single valid object and its valid votes
+        {
+            LOCK(cs);
+
             object_m_it it = mapObjects.find(nProp);
             if(it == mapObjects.end()) {
                 LogPrint("gobject", "CGovernanceManager::Sync -- no matching object for hash %s, peer=%d\n", nProp.ToString(), pfrom->id);
@@ -793,17 +815,40 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
             LogPrint("gobject", "CGovernanceManager::Sync -- syncing govobj: %s, peer=%d\n", strHash, pfrom->id);
             pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
             ++nObjCount;
+        }
 
-            std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-            for(size_t i = 0; i < vecVotes.size(); ++i) {
-                if(filter.contains(vecVotes[i].GetHash())) {
-                    continue;
+        // Stream the votes in batches so cs is only held for one batch at a time.
+        // Signatures were checked when the votes were accepted into the vote file,
+        // only make sure their masternodes are still around.
+        uint256 nHashLast;
+        while(true) {
+            std::vector<uint256> vecHashes;
+            size_t nBatchSize = 0;
+            {
+                LOCK(cs);
+                object_m_it it = mapObjects.find(nProp);
+                if(it == mapObjects.end()) {
+                    break;
                 }
-                if(!vecVotes[i].IsValid(true)) {
-                    continue;
+                std::vector<CGovernanceVote> vecVotes = it->second.GetVoteFile().GetVotesAfter(nHashLast, SYNC_VOTE_BATCH_SIZE);
+                nBatchSize = vecVotes.size();
+                for(size_t i = 0; i < vecVotes.size(); ++i) {
+                    nHashLast = vecVotes[i].GetHash();
+                    if(filter.contains(nHashLast)) {
+                        continue;
+                    }
+                    if(!vecVotes[i].IsValid(false)) {
+                        continue;
+                    }
+                    vecHashes.push_back(nHashLast);
                 }
-                pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, vecVotes[i].GetHash()));
-                ++nVoteCount;
+            }
+            for(size_t i = 0; i < vecHashes.size(); ++i) {
+                pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, vecHashes[i]));
+            }
+            nVoteCount += vecHashes.size();
+            if(nBatchSize < SYNC_VOTE_BATCH_SIZE) {
+                break;
             }
         }
     }
@@ -1218,8 +1263,10 @@ int CGovernanceManager::RequestGovernanceObjectVotes(const std::vector<CNode*>&
             // only use up to date peers
             if(pnode->nVersion < MIN_GOVERNANCE_PEER_PROTO_VERSION) continue;
             // stop early to prevent setAskFor overflow
-            size_t nProjectedSize = pnode->setAskFor.size() + nProjectedVotes;
-            if(nProjectedSize > SETASKFOR_MAX_SZ/2) continue;
+            {
+                LOCK(pnode->cs_inventory);
+                if(pnode->setAskFor.size() + nProjectedVotes > SETASKFOR_MAX_SZ/2) continue;
+            }
             // to early to ask the same node
             if(mapAskedRecently[nHashGovobj].count(pnode->addr)) continue;
 
@@ -221,6 +221,9 @@ public: // Types
 private:
     static const int MAX_CACHE_SIZE = 1000000;
 
+    /// Votes announced per batch when syncing an object's votes to a peer
+    static const size_t SYNC_VOTE_BATCH_SIZE = 1000;
+
     static const std::string SERIALIZATION_VERSION_STRING;
 
     static const int MAX_TIME_FUTURE_DEVIATION;
@@ -309,6 +312,7 @@ public:
 
     std::vector<CGovernanceVote> GetMatchingVotes(const uint256& nParentHash);
     std::vector<CGovernanceVote> GetCurrentVotes(const uint256& nParentHash, const COutPoint& mnCollateralOutpointFilter);
+    std::vector<CGovernanceVote> GetMasternodeVotes(const COutPoint& mnCollateralOutpoint);
     std::vector<CGovernanceObject*> GetAllNewerThan(int64_t nMoreThanTime);
 
     bool IsBudgetPaymentBlock(int nBlockHeight);
@@ -63,7 +63,7 @@ void CInstantSend::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataSt
 
         uint256 nVoteHash = vote.GetHash();
 
-        pfrom->setAskFor.erase(nVoteHash);
+        pfrom->RemoveAskFor(nVoteHash);
 
         // Ignore any InstantSend messages until masternode list is synced
         if(!masternodeSync.IsMasternodeListSynced()) return;
@@ -860,69 +860,64 @@ void CInstantSend::UpdatedBlockTip(const CBlockIndex *pindex)
     nCachedBlockHeight = pindex->nHeight;
 }
 
-void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
+void CInstantSend::BlockConnected(const CBlock& block, const CBlockIndex* pindex)
 {
-    // Update lock candidates and votes if corresponding tx confirmed
-    // or went from confirmed to 0-confirmed or conflicted.
+    UpdateConfirmedHeights(block, pindex->nHeight);
+}
 
-    if (tx.IsCoinBase()) return;
+void CInstantSend::BlockDisconnected(const CBlock& block)
+{
+    // Transactions of a disconnected block are 0-confirmed again
+    UpdateConfirmedHeights(block, -1);
+}
 
-    LOCK2(cs_main, cs_instantsend);
+void CInstantSend::UpdateConfirmedHeights(const CBlock& block, int nHeightNew)
+{
+    // Update lock candidates and votes of all transactions in the block at once,
+    // they either got confirmed or went from confirmed to 0-confirmed.
 
-    uint256 txHash = tx.GetHash();
+    LOCK(cs_instantsend);
 
-    // When tx is 0-confirmed or conflicted, pblock is NULL and nHeightNew should be set to -1
-    CBlockIndex* pblockindex = NULL;
-    if(pblock) {
-        uint256 blockHash = pblock->GetHash();
-        BlockMap::iterator mi = mapBlockIndex.find(blockHash);
-        if(mi == mapBlockIndex.end() || !mi->second) {
-            // shouldn't happen
-            LogPrint("instantsend", "CTxLockRequest::SyncTransaction -- Failed to find block %s\n", blockHash.ToString());
-            return;
-        }
-        pblockindex = mi->second;
-    }
-    int nHeightNew = pblockindex ? pblockindex->nHeight : -1;
+    if(mapTxLockCandidates.empty() && mapTxLockVotesOrphan.empty()) return;
 
-    LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d\n", txHash.ToString(), nHeightNew);
+    std::set<uint256> setTxHashes;
+    BOOST_FOREACH(const CTransaction& tx, block.vtx) {
+        if(tx.IsCoinBase()) continue;
+        uint256 txHash = tx.GetHash();
+        setTxHashes.insert(txHash);
 
-    // Check lock candidates
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
-    if(itLockCandidate != mapTxLockCandidates.end()) {
-        LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d lock candidate updated\n",
+        // Check lock candidates
+        std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+        if(itLockCandidate == mapTxLockCandidates.end()) continue;
+
+        LogPrint("instantsend", "CInstantSend::UpdateConfirmedHeights -- txid=%s nHeightNew=%d lock candidate updated\n",
                 txHash.ToString(), nHeightNew);
         itLockCandidate->second.SetConfirmedHeight(nHeightNew);
-        // Loop through outpoint locks
+        // Loop through outpoint locks and update corresponding lock votes
         std::map<COutPoint, COutPointLock>::iterator itOutpointLock = itLockCandidate->second.mapOutPointLocks.begin();
-        while(itOutpointLock != itLockCandidate->second.mapOutPointLocks.end()) {
-            // Check corresponding lock votes
-            std::vector<CTxLockVote> vVotes = itOutpointLock->second.GetVotes();
-            std::vector<CTxLockVote>::iterator itVote = vVotes.begin();
-            std::map<uint256, CTxLockVote>::iterator it;
-            while(itVote != vVotes.end()) {
-                uint256 nVoteHash = itVote->GetHash();
-                LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
+        for(; itOutpointLock != itLockCandidate->second.mapOutPointLocks.end(); ++itOutpointLock) {
+            const std::map<COutPoint, CTxLockVote>& mapVotes = itOutpointLock->second.GetMasternodeVotes();
+            std::map<COutPoint, CTxLockVote>::const_iterator itVote = mapVotes.begin();
+            for(; itVote != mapVotes.end(); ++itVote) {
+                uint256 nVoteHash = itVote->second.GetHash();
+                LogPrint("instantsend", "CInstantSend::UpdateConfirmedHeights -- txid=%s nHeightNew=%d vote %s updated\n",
                         txHash.ToString(), nHeightNew, nVoteHash.ToString());
-                it = mapTxLockVotes.find(nVoteHash);
+                std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotes.find(nVoteHash);
                 if(it != mapTxLockVotes.end()) {
                     it->second.SetConfirmedHeight(nHeightNew);
                 }
-                ++itVote;
             }
-            ++itOutpointLock;
         }
     }
 
     // check orphan votes
     std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
-    while(itOrphanVote != mapTxLockVotesOrphan.end()) {
-        if(itOrphanVote->second.GetTxHash() == txHash) {
-            LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
-                    txHash.ToString(), nHeightNew, itOrphanVote->first.ToString());
+    for(; itOrphanVote != mapTxLockVotesOrphan.end(); ++itOrphanVote) {
+        if(setTxHashes.count(itOrphanVote->second.GetTxHash())) {
+            LogPrint("instantsend", "CInstantSend::UpdateConfirmedHeights -- txid=%s nHeightNew=%d vote %s updated\n",
+                    itOrphanVote->second.GetTxHash().ToString(), nHeightNew, itOrphanVote->first.ToString());
             mapTxLockVotes[itOrphanVote->first].SetConfirmedHeight(nHeightNew);
         }
-        ++itOrphanVote;
     }
 }
 
@@ -80,6 +80,9 @@ private:
 
     bool IsInstantSendReadyToLock(const uint256 &txHash);
 
+    // set confirmed height of lock candidates and votes for all txes in the block, -1 when it was disconnected
+    void UpdateConfirmedHeights(const CBlock& block, int nHeightNew);
+
 public:
     CCriticalSection cs_instantsend;
 
@@ -114,7 +117,8 @@ public:
     void Relay(const uint256& txHash, CConnman& connman);
 
     void UpdatedBlockTip(const CBlockIndex *pindex);
-    void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
+    void BlockConnected(const CBlock& block, const CBlockIndex* pindex);
+    void BlockDisconnected(const CBlock& block);
 
     std::string ToString();
 };
@@ -218,6 +222,7 @@ public:
 
     bool AddVote(const CTxLockVote& vote);
     std::vector<CTxLockVote> GetVotes() const;
+    const std::map<COutPoint, CTxLockVote>& GetMasternodeVotes() const { return mapMasternodeVotes; }
     bool HasMasternodeVoted(const COutPoint& outpointMasternodeIn) const;
     int CountVotes() const { return fAttacked ? 0 : mapMasternodeVotes.size(); }
     bool IsReady() const { return !fAttacked && CountVotes() >= SIGNATURES_REQUIRED; }
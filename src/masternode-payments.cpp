@@ -3,12 +3,15 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "activemasternode.h"
+#include "crypto/common.h"
 #include "governance-classes.h"
+#include "hash.h"
 #include "masternode-payments.h"
 #include "masternode-sync.h"
 #include "masternodeman.h"
 #include "messagesigner.h"
 #include "netfulfilledman.h"
+#include "random.h"
 #include "spork.h"
 #include "util.h"
 
@@ -21,6 +24,21 @@ CCriticalSection cs_vecPayees;
 CCriticalSection cs_mapMasternodeBlocks;
 CCriticalSection cs_mapMasternodePaymentVotes;
 
+SaltedKeyIDHasher::SaltedKeyIDHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+size_t SaltedKeyIDHasher::operator()(const CKeyID& id) const
+{
+    return CSipHasher(k0, k1).Write(id.GetUint64(0)).Write(id.GetUint64(1)).Write(ReadLE32(id.begin() + 16)).Finalize();
+}
+
+/** The key a P2PKH payee pays to, other payees can't be a masternode's */
+static bool GetPayeeKeyID(const CScript& payee, CKeyID& keyIDRet)
+{
+    if(!payee.IsPayToPublicKeyHash()) return false;
+    keyIDRet = CKeyID(uint160(std::vector<unsigned char>(payee.begin() + 3, payee.begin() + 23)));
+    return true;
+}
+
 /**
 * IsBlockValueValid
 *
@@ -239,7 +257,75 @@ void CMasternodePayments::Clear()
 {
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
     mapMasternodeBlocks.clear();
+    mapScheduledPayees.clear();
     mapMasternodePaymentVotes.clear();
+    mapVoteHashesByHeight.clear();
+}
+
+void CMasternodePayments::StoreVote(const CMasternodePaymentVote& vote)
+{
+    AssertLockHeld(cs_mapMasternodePaymentVotes);
+    uint256 nHash = vote.GetHash();
+    auto res = mapMasternodePaymentVotes.emplace(nHash, vote);
+    if(res.second) {
+        mapVoteHashesByHeight[vote.nBlockHeight].push_back(nHash);
+    } else {
+        res.first->second = vote;
+    }
+}
+
+void CMasternodePayments::RebuildVoteHashesByHeight()
+{
+    LOCK(cs_mapMasternodePaymentVotes);
+    mapVoteHashesByHeight.clear();
+    for (auto& votepair : mapMasternodePaymentVotes) {
+        mapVoteHashesByHeight[votepair.second.nBlockHeight].push_back(votepair.first);
+    }
+}
+
+void CMasternodePayments::AddScheduledPayee(const CScript& payee, int nBlockHeight)
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+    CKeyID keyID;
+    if(!GetPayeeKeyID(payee, keyID)) return;
+    mapScheduledPayees[keyID].insert(nBlockHeight);
+}
+
+void CMasternodePayments::RemoveScheduledPayee(const CScript& payee, int nBlockHeight)
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+    CKeyID keyID;
+    if(!GetPayeeKeyID(payee, keyID)) return;
+    auto it = mapScheduledPayees.find(keyID);
+    if(it == mapScheduledPayees.end()) return;
+    it->second.erase(nBlockHeight);
+    if(it->second.empty()) {
+        mapScheduledPayees.erase(it);
+    }
+}
+
+void CMasternodePayments::EraseMasternodeBlock(int nBlockHeight)
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+    std::map<int, CMasternodeBlockPayees>::iterator it = mapMasternodeBlocks.find(nBlockHeight);
+    if(it == mapMasternodeBlocks.end()) return;
+    CScript payee;
+    if(!it->second.vecPayees.empty() && it->second.GetBestPayee(payee)) {
+        RemoveScheduledPayee(payee, nBlockHeight);
+    }
+    mapMasternodeBlocks.erase(it);
+}
+
+void CMasternodePayments::RebuildScheduledPayees()
+{
+    LOCK(cs_mapMasternodeBlocks);
+    mapScheduledPayees.clear();
+    for (auto& blockpair : mapMasternodeBlocks) {
+        CScript payee;
+        if(!blockpair.second.vecPayees.empty() && blockpair.second.GetBestPayee(payee)) {
+            AddScheduledPayee(payee, blockpair.first);
+        }
+    }
 }
 
 bool CMasternodePayments::CanVote(COutPoint outMasternode, int nBlockHeight)
@@ -337,7 +423,7 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, std::string& strCommand,
 
         uint256 nHash = vote.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        pfrom->RemoveAskFor(nHash);
 
         // TODO: clear setAskFor for MSG_MASTERNODE_PAYMENT_BLOCK too
 
@@ -352,7 +438,7 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, std::string& strCommand,
             }
 
             // Avoid processing same vote multiple times
-            mapMasternodePaymentVotes[nHash] = vote;
+            StoreVote(vote);
             // but first mark vote as non-verified,
             // AddPaymentVote() below should take care of it if vote is actually ok
             mapMasternodePaymentVotes[nHash].MarkAsNotVerified();
@@ -452,15 +538,12 @@ bool CMasternodePayments::IsScheduled(CMasternode& mn, int nNotBlockHeight)
 
     if(!masternodeSync.IsMasternodeListSynced()) return false;
 
-    CScript mnpayee;
-    mnpayee = GetScriptForDestination(mn.pubKeyCollateralAddress.GetID());
+    auto it = mapScheduledPayees.find(mn.pubKeyCollateralAddress.GetID());
+    if(it == mapScheduledPayees.end()) return false;
 
-    CScript payee;
-    for(int64_t h = nCachedBlockHeight; h <= nCachedBlockHeight + 8; h++){
-        if(h == nNotBlockHeight) continue;
-        if(mapMasternodeBlocks.count(h) && mapMasternodeBlocks[h].GetBestPayee(payee) && mnpayee == payee) {
-            return true;
-        }
+    std::set<int>::const_iterator itHeight = it->second.lower_bound(nCachedBlockHeight);
+    for(; itHeight != it->second.end() && *itHeight <= nCachedBlockHeight + 8; ++itHeight) {
+        if(*itHeight != nNotBlockHeight) return true;
     }
 
     return false;
@@ -475,14 +558,25 @@ bool CMasternodePayments::AddPaymentVote(const CMasternodePaymentVote& vote)
 
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
 
-    mapMasternodePaymentVotes[vote.GetHash()] = vote;
+    StoreVote(vote);
 
     if(!mapMasternodeBlocks.count(vote.nBlockHeight)) {
        CMasternodeBlockPayees blockPayees(vote.nBlockHeight);
        mapMasternodeBlocks[vote.nBlockHeight] = blockPayees;
     }
 
-    mapMasternodeBlocks[vote.nBlockHeight].AddPayee(vote);
+    CMasternodeBlockPayees& blockPayees = mapMasternodeBlocks[vote.nBlockHeight];
+    CScript payeeOld;
+    bool fHadPayee = !blockPayees.vecPayees.empty() && blockPayees.GetBestPayee(payeeOld);
+
+    blockPayees.AddPayee(vote);
+
+    // the vote may have made another payee the best one for this block
+    CScript payeeNew;
+    if(blockPayees.GetBestPayee(payeeNew) && (!fHadPayee || payeeNew != payeeOld)) {
+        if(fHadPayee) RemoveScheduledPayee(payeeOld, vote.nBlockHeight);
+        AddScheduledPayee(payeeNew, vote.nBlockHeight);
+    }
 
     return true;
 }
@@ -490,10 +584,26 @@ bool CMasternodePayments::AddPaymentVote(const CMasternodePaymentVote& vote)
 bool CMasternodePayments::HasVerifiedPaymentVote(uint256 hashIn)
 {
     LOCK(cs_mapMasternodePaymentVotes);
-    std::map<uint256, CMasternodePaymentVote>::iterator it = mapMasternodePaymentVotes.find(hashIn);
+    auto it = mapMasternodePaymentVotes.find(hashIn);
     return it != mapMasternodePaymentVotes.end() && it->second.IsVerified();
 }
 
+bool CMasternodePayments::HasPaymentVote(const uint256& hashIn)
+{
+    LOCK(cs_mapMasternodePaymentVotes);
+    return mapMasternodePaymentVotes.count(hashIn);
+}
+
+bool CMasternodePayments::GetVerifiedPaymentVote(const uint256& hashIn, CMasternodePaymentVote& voteRet)
+{
+    LOCK(cs_mapMasternodePaymentVotes);
+    auto it = mapMasternodePaymentVotes.find(hashIn);
+    if (it == mapMasternodePaymentVotes.end() || !it->second.IsVerified())
+        return false;
+    voteRet = it->second;
+    return true;
+}
+
 void CMasternodeBlockPayees::AddPayee(const CMasternodePaymentVote& vote)
 {
     LOCK(cs_vecPayees);
@@ -639,17 +749,15 @@ void CMasternodePayments::CheckAndRemove()
 
     int nLimit = GetStorageLimit();
 
-    std::map<uint256, CMasternodePaymentVote>::iterator it = mapMasternodePaymentVotes.begin();
-    while(it != mapMasternodePaymentVotes.end()) {
-        CMasternodePaymentVote vote = (*it).second;
-
-        if(nCachedBlockHeight - vote.nBlockHeight > nLimit) {
-            LogPrint("mnpayments", "CMasternodePayments::CheckAndRemove -- Removing old Masternode payment: nBlockHeight=%d\n", vote.nBlockHeight);
-            mapMasternodePaymentVotes.erase(it++);
-            mapMasternodeBlocks.erase(vote.nBlockHeight);
-        } else {
-            ++it;
+    // buckets are ordered by height, so everything too old sits at the front
+    std::map<int, std::vector<uint256> >::iterator it = mapVoteHashesByHeight.begin();
+    while(it != mapVoteHashesByHeight.end() && nCachedBlockHeight - it->first > nLimit) {
+        LogPrint("mnpayments", "CMasternodePayments::CheckAndRemove -- Removing %d old Masternode payment votes: nBlockHeight=%d\n", it->second.size(), it->first);
+        BOOST_FOREACH(const uint256& hash, it->second) {
+            mapMasternodePaymentVotes.erase(hash);
         }
+        EraseMasternodeBlock(it->first);
+        mapVoteHashesByHeight.erase(it++);
     }
     LogPrintf("CMasternodePayments::CheckAndRemove -- %s\n", ToString());
 }
@@ -888,22 +996,19 @@ std::string CMasternodePaymentVote::ToString() const
 // Send only votes for future blocks, node should request every other missing payment block individually
 void CMasternodePayments::Sync(CNode* pnode, CConnman& connman)
 {
-    LOCK(cs_mapMasternodeBlocks);
+    LOCK(cs_mapMasternodePaymentVotes);
 
     if(!masternodeSync.IsWinnersListSynced()) return;
 
     int nInvCount = 0;
 
-    for(int h = nCachedBlockHeight; h < nCachedBlockHeight + 20; h++) {
-        if(mapMasternodeBlocks.count(h)) {
-            BOOST_FOREACH(CMasternodePayee& payee, mapMasternodeBlocks[h].vecPayees) {
-                std::vector<uint256> vecVoteHashes = payee.GetVoteHashes();
-                BOOST_FOREACH(uint256& hash, vecVoteHashes) {
-                    if(!HasVerifiedPaymentVote(hash)) continue;
-                    pnode->PushInventory(CInv(MSG_MASTERNODE_PAYMENT_VOTE, hash));
-                    nInvCount++;
-                }
-            }
+    std::map<int, std::vector<uint256> >::iterator it = mapVoteHashesByHeight.lower_bound(nCachedBlockHeight);
+    for(; it != mapVoteHashesByHeight.end() && it->first < nCachedBlockHeight + 20; ++it) {
+        BOOST_FOREACH(const uint256& hash, it->second) {
+            auto itVote = mapMasternodePaymentVotes.find(hash);
+            if(itVote == mapMasternodePaymentVotes.end() || !itVote->second.IsVerified()) continue;
+            pnode->PushInventory(CInv(MSG_MASTERNODE_PAYMENT_VOTE, hash));
+            nInvCount++;
         }
     }
 
@@ -10,8 +10,11 @@
 #include "key.h"
 #include "masternode.h"
 #include "net_processing.h"
+#include "saltedhasher.h"
 #include "utilstrencodings.h"
 
+#include <unordered_map>
+
 class CMasternodePayments;
 class CMasternodePaymentVote;
 class CMasternodeBlockPayees;
@@ -159,6 +162,18 @@ public:
     std::string ToString() const;
 };
 
+class SaltedKeyIDHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedKeyIDHasher();
+
+    size_t operator()(const CKeyID& id) const;
+};
+
 //
 // Masternode Payments Class
 // Keeps track of who should get paid for which blocks
@@ -175,8 +190,26 @@ private:
     // Keep track of current block height
     int nCachedBlockHeight;
 
+    /// Heights each payee is the best payee of, by the key of its P2PKH script as that's what masternodes are paid to.
+    /// Protected by cs_mapMasternodeBlocks and kept up to date with every change to mapMasternodeBlocks.
+    std::unordered_map<CKeyID, std::set<int>, SaltedKeyIDHasher> mapScheduledPayees;
+
+    void AddScheduledPayee(const CScript& payee, int nBlockHeight);
+    void RemoveScheduledPayee(const CScript& payee, int nBlockHeight);
+    /// Forget nBlockHeight in mapScheduledPayees and mapMasternodeBlocks
+    void EraseMasternodeBlock(int nBlockHeight);
+    void RebuildScheduledPayees();
+
+    /// Hashes of every vote in mapMasternodePaymentVotes, bucketed by the height the vote is for.
+    /// Protected by cs_mapMasternodePaymentVotes, old votes are expired one whole bucket at a time.
+    std::map<int, std::vector<uint256> > mapVoteHashesByHeight;
+
+    /// Put vote into mapMasternodePaymentVotes, filing its hash under its height if it's new
+    void StoreVote(const CMasternodePaymentVote& vote);
+    void RebuildVoteHashesByHeight();
+
 public:
-    std::map<uint256, CMasternodePaymentVote> mapMasternodePaymentVotes;
+    std::unordered_map<uint256, CMasternodePaymentVote, SaltedTxidHasher> mapMasternodePaymentVotes;
     std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
     std::map<COutPoint, int> mapMasternodesLastVote;
     std::map<COutPoint, int> mapMasternodesDidNotVote;
@@ -189,12 +222,18 @@ public:
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
         READWRITE(mapMasternodePaymentVotes);
         READWRITE(mapMasternodeBlocks);
+        if(ser_action.ForRead()) {
+            RebuildVoteHashesByHeight();
+            RebuildScheduledPayees();
+        }
     }
 
     void Clear();
 
     bool AddPaymentVote(const CMasternodePaymentVote& vote);
     bool HasVerifiedPaymentVote(uint256 hashIn);
+    bool HasPaymentVote(const uint256& hashIn);
+    bool GetVerifiedPaymentVote(const uint256& hashIn, CMasternodePaymentVote& voteRet);
     bool ProcessBlock(int nBlockHeight, CConnman& connman);
     void CheckPreviousBlockVotes(int nPrevBlockHeight);
 
@@ -4,6 +4,7 @@
 
 #include "activemasternode.h"
 #include "addrman.h"
+#include "checkqueue.h"
 #include "governance.h"
 #include "masternode-payments.h"
 #include "masternode-sync.h"
@@ -39,6 +40,81 @@ struct CompareScoreMN
     }
 };
 
+/** Orders score pairs from the highest score down, the order ranks are handed out in */
+struct CompareScoreMNDescending
+{
+    bool operator()(const CMasternodeMan::score_pair_t& t1,
+                    const CMasternodeMan::score_pair_t& t2) const
+    {
+        return CompareScoreMN()(t2, t1);
+    }
+};
+
+/**
+ * Closure representing the scoring of one slice of a score vector: every entry
+ * gets its score for the block hash and the slice is left sorted highest first,
+ * so the caller only has to merge the slices.
+ */
+class CMasternodeScoreCheck
+{
+private:
+    CMasternodeMan::score_pair_t* pbegin;
+    CMasternodeMan::score_pair_t* pend;
+    const uint256* pBlockHash;
+
+public:
+    CMasternodeScoreCheck(): pbegin(NULL), pend(NULL), pBlockHash(NULL) {}
+    CMasternodeScoreCheck(CMasternodeMan::score_pair_t* pbeginIn, CMasternodeMan::score_pair_t* pendIn, const uint256& blockHash) :
+        pbegin(pbeginIn), pend(pendIn), pBlockHash(&blockHash) {}
+
+    bool operator()() {
+        for (CMasternodeMan::score_pair_t* p = pbegin; p != pend; ++p)
+            p->first = p->second->CalculateScore(*pBlockHash);
+        std::sort(pbegin, pend, CompareScoreMNDescending());
+        return true;
+    }
+
+    void swap(CMasternodeScoreCheck& check) {
+        std::swap(pbegin, check.pbegin);
+        std::swap(pend, check.pend);
+        std::swap(pBlockHash, check.pBlockHash);
+    }
+};
+
+/** Masternodes scored per CMasternodeScoreCheck */
+static const size_t MASTERNODE_SCORE_SLICE_SIZE = 128;
+
+/**
+ * Closure checking one signature of a queued announce or ping. A valid signature
+ * lands in the message signature cache, so checking it again while the message is
+ * processed in order is a cache hit. Failures are simply checked and reported
+ * again at that point.
+ */
+class CMasternodeSigCheck
+{
+private:
+    const CPubKey* pPubKey;
+    const std::vector<unsigned char>* pvchSig;
+    std::string strMessage;
+
+public:
+    CMasternodeSigCheck(): pPubKey(NULL), pvchSig(NULL) {}
+    CMasternodeSigCheck(const CPubKey& pubKey, const std::vector<unsigned char>& vchSig, const std::string& strMessageIn) :
+        pPubKey(&pubKey), pvchSig(&vchSig), strMessage(strMessageIn) {}
+
+    bool operator()() {
+        std::string strError;
+        CMessageSigner::VerifyMessage(*pPubKey, *pvchSig, strMessage, strError);
+        return true;
+    }
+
+    void swap(CMasternodeSigCheck& check) {
+        std::swap(pPubKey, check.pPubKey);
+        std::swap(pvchSig, check.pvchSig);
+        strMessage.swap(check.strMessage);
+    }
+};
+
 struct CompareByAddr
 
 {
@@ -63,6 +139,18 @@ CMasternodeMan::CMasternodeMan()
   fMasternodesRemoved(false),
   vecDirtyGovernanceObjectHashes(),
   nLastWatchdogVoteTime(0),
+  mapRankTables(RANK_TABLE_CACHE_SIZE),
+  pMasternodesSnapshot(std::make_shared<masternode_map_t>()),
+  fSnapshotStale(false),
+  cs_pending(),
+  dequePendingMessages(),
+  cs_process_pending(),
+  nVerifyBatches(0),
+  nVerifiedSignatures(0),
+  nVerifyMicros(0),
+  wheelWeAskedForMasternodeListEntry(EXPIRY_BUCKET_SECONDS),
+  wheelSeenMasternodePing(EXPIRY_BUCKET_SECONDS),
+  wheelSeenMasternodeVerification(1),
   mapSeenMasternodeBroadcast(),
   mapSeenMasternodePing(),
   nDsqCount(0)
@@ -72,21 +160,53 @@ bool CMasternodeMan::Add(CMasternode &mn)
 {
     LOCK(cs);
 
-    if (Has(mn.vin.prevout)) return false;
+    if (mapMasternodes.count(mn.vin.prevout)) return false;
 
     LogPrint("masternode", "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
     mapMasternodes[mn.vin.prevout] = mn;
     fMasternodesAdded = true;
+    InvalidateRankTables();
+    MarkSnapshotStale();
+    return true;
+}
+
+bool CMasternodeMan::AddSeenMasternodePing(const CMasternodePing& mnp)
+{
+    LOCK(cs);
+    if(!mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp)).second) return false;
+    wheelSeenMasternodePing.Add(mnp.GetHash(), mnp.sigTime + MASTERNODE_NEW_START_REQUIRED_SECONDS);
     return true;
 }
 
+void CMasternodeMan::AddSeenMasternodeVerification(const CMasternodeVerification& mnv)
+{
+    LOCK(cs);
+    if(!mapSeenMasternodeVerification.insert(std::make_pair(mnv.GetHash(), mnv)).second) return;
+    wheelSeenMasternodeVerification.Add(mnv.GetHash(), mnv.nBlockHeight + MAX_POSE_BLOCKS + 1);
+}
+
+void CMasternodeMan::RebuildExpiryWheels()
+{
+    AssertLockHeld(cs);
+    wheelWeAskedForMasternodeListEntry.Clear();
+    for (const auto& entry : mWeAskedForMasternodeListEntry) {
+        for (const auto& asked : entry.second) {
+            wheelWeAskedForMasternodeListEntry.Add(entry.first, asked.second);
+        }
+    }
+    wheelSeenMasternodePing.Clear();
+    for (const auto& seen : mapSeenMasternodePing) {
+        wheelSeenMasternodePing.Add(seen.first, seen.second.sigTime + MASTERNODE_NEW_START_REQUIRED_SECONDS);
+    }
+}
+
 void CMasternodeMan::AskForMN(CNode* pnode, const COutPoint& outpoint, CConnman& connman)
 {
     if(!pnode) return;
 
     LOCK(cs);
 
-    std::map<COutPoint, std::map<CNetAddr, int64_t> >::iterator it1 = mWeAskedForMasternodeListEntry.find(outpoint);
+    auto it1 = mWeAskedForMasternodeListEntry.find(outpoint);
     if (it1 != mWeAskedForMasternodeListEntry.end()) {
         std::map<CNetAddr, int64_t>::iterator it2 = it1->second.find(pnode->addr);
         if (it2 != it1->second.end()) {
@@ -105,6 +225,7 @@ void CMasternodeMan::AskForMN(CNode* pnode, const COutPoint& outpoint, CConnman&
         LogPrintf("CMasternodeMan::AskForMN -- Asking peer %s for missing masternode entry for the first time: %s\n", pnode->addr.ToString(), outpoint.ToStringShort());
     }
     mWeAskedForMasternodeListEntry[outpoint][pnode->addr] = GetTime() + DSEG_UPDATE_SECONDS;
+    wheelWeAskedForMasternodeListEntry.Add(outpoint, GetTime() + DSEG_UPDATE_SECONDS);
 
     connman.PushMessage(pnode, NetMsgType::DSEG, CTxIn(outpoint));
 }
@@ -119,6 +240,7 @@ bool CMasternodeMan::AllowMixing(const COutPoint &outpoint)
     nDsqCount++;
     pmn->nLastDsq = nDsqCount;
     pmn->fAllowMixingTx = true;
+    MarkSnapshotStale();
 
     return true;
 }
@@ -131,6 +253,7 @@ bool CMasternodeMan::DisallowMixing(const COutPoint &outpoint)
         return false;
     }
     pmn->fAllowMixingTx = false;
+    MarkSnapshotStale();
 
     return true;
 }
@@ -143,19 +266,34 @@ bool CMasternodeMan::PoSeBan(const COutPoint &outpoint)
         return false;
     }
     pmn->PoSeBan();
+    MarkSnapshotStale();
 
     return true;
 }
 
+bool CMasternodeMan::CheckEntry(CMasternode& mn, bool fForce)
+{
+    AssertLockHeld(cs);
+    int nActiveStatePrev = mn.nActiveState;
+    int nPoSeBanScorePrev = mn.nPoSeBanScore;
+    int nPoSeBanHeightPrev = mn.nPoSeBanHeight;
+    mn.Check(fForce);
+    return mn.nActiveState != nActiveStatePrev || mn.nPoSeBanScore != nPoSeBanScorePrev || mn.nPoSeBanHeight != nPoSeBanHeightPrev;
+}
+
 void CMasternodeMan::Check()
 {
     LOCK(cs);
 
     LogPrint("masternode", "CMasternodeMan::Check -- nLastWatchdogVoteTime=%d, IsWatchdogActive()=%d\n", nLastWatchdogVoteTime, IsWatchdogActive());
 
+    bool fChanged = false;
     for (auto& mnpair : mapMasternodes) {
-        mnpair.second.Check();
+        if (CheckEntry(mnpair.second))
+            fChanged = true;
     }
+    if (fChanged)
+        MarkSnapshotStale();
 }
 
 void CMasternodeMan::CheckAndRemove(CConnman& connman)
@@ -191,6 +329,8 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
                 it->second.FlagGovernanceItemsAsDirty();
                 mapMasternodes.erase(it++);
                 fMasternodesRemoved = true;
+                InvalidateRankTables();
+                MarkSnapshotStale();
             } else {
                 bool fAsk = (nAskForMnbRecovery > 0) &&
                             masternodeSync.IsSynced() &&
@@ -284,21 +424,26 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
             }
         }
 
-        // check which Masternodes we've asked for
-        std::map<COutPoint, std::map<CNetAddr, int64_t> >::iterator it2 = mWeAskedForMasternodeListEntry.begin();
-        while(it2 != mWeAskedForMasternodeListEntry.end()){
+        // check which Masternodes we've asked for, only those with a request that might be due
+        std::vector<COutPoint> vecDueOutpoints;
+        wheelWeAskedForMasternodeListEntry.PopExpired(GetTime(), vecDueOutpoints);
+        BOOST_FOREACH(const COutPoint& outpoint, vecDueOutpoints) {
+            auto it2 = mWeAskedForMasternodeListEntry.find(outpoint);
+            if(it2 == mWeAskedForMasternodeListEntry.end()) continue;
+            int64_t nNextExpiry = std::numeric_limits<int64_t>::max();
             std::map<CNetAddr, int64_t>::iterator it3 = it2->second.begin();
             while(it3 != it2->second.end()){
                 if(it3->second < GetTime()){
                     it2->second.erase(it3++);
                 } else {
+                    nNextExpiry = std::min(nNextExpiry, it3->second);
                     ++it3;
                 }
             }
             if(it2->second.empty()) {
-                mWeAskedForMasternodeListEntry.erase(it2++);
+                mWeAskedForMasternodeListEntry.erase(it2);
             } else {
-                ++it2;
+                wheelWeAskedForMasternodeListEntry.Add(outpoint, nNextExpiry);
             }
         }
 
@@ -314,24 +459,30 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
         // NOTE: do not expire mapSeenMasternodeBroadcast entries here, clean them on mnb updates!
 
         // remove expired mapSeenMasternodePing
-        std::map<uint256, CMasternodePing>::iterator it4 = mapSeenMasternodePing.begin();
-        while(it4 != mapSeenMasternodePing.end()){
+        std::vector<uint256> vecDueHashes;
+        wheelSeenMasternodePing.PopExpired(GetAdjustedTime(), vecDueHashes);
+        BOOST_FOREACH(const uint256& hash, vecDueHashes) {
+            auto it4 = mapSeenMasternodePing.find(hash);
+            if(it4 == mapSeenMasternodePing.end()) continue;
             if((*it4).second.IsExpired()) {
                 LogPrint("masternode", "CMasternodeMan::CheckAndRemove -- Removing expired Masternode ping: hash=%s\n", (*it4).second.GetHash().ToString());
-                mapSeenMasternodePing.erase(it4++);
+                mapSeenMasternodePing.erase(it4);
             } else {
-                ++it4;
+                wheelSeenMasternodePing.Add(hash, (*it4).second.sigTime + MASTERNODE_NEW_START_REQUIRED_SECONDS);
             }
         }
 
         // remove expired mapSeenMasternodeVerification
-        std::map<uint256, CMasternodeVerification>::iterator itv2 = mapSeenMasternodeVerification.begin();
-        while(itv2 != mapSeenMasternodeVerification.end()){
+        vecDueHashes.clear();
+        wheelSeenMasternodeVerification.PopExpired(nCachedBlockHeight, vecDueHashes);
+        BOOST_FOREACH(const uint256& hash, vecDueHashes) {
+            auto itv2 = mapSeenMasternodeVerification.find(hash);
+            if(itv2 == mapSeenMasternodeVerification.end()) continue;
             if((*itv2).second.nBlockHeight < nCachedBlockHeight - MAX_POSE_BLOCKS){
                 LogPrint("masternode", "CMasternodeMan::CheckAndRemove -- Removing expired Masternode verification: hash=%s\n", (*itv2).first.ToString());
-                mapSeenMasternodeVerification.erase(itv2++);
+                mapSeenMasternodeVerification.erase(itv2);
             } else {
-                ++itv2;
+                wheelSeenMasternodeVerification.Add(hash, (*itv2).second.nBlockHeight + MAX_POSE_BLOCKS + 1);
             }
         }
 
@@ -347,11 +498,15 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     mapMasternodes.clear();
+    InvalidateRankTables();
+    MarkSnapshotStale();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
     mapSeenMasternodeBroadcast.clear();
     mapSeenMasternodePing.clear();
+    wheelWeAskedForMasternodeListEntry.Clear();
+    wheelSeenMasternodePing.Clear();
     nDsqCount = 0;
     nLastWatchdogVoteTime = 0;
 }
@@ -429,6 +584,20 @@ CMasternode* CMasternodeMan::Find(const COutPoint &outpoint)
     return it == mapMasternodes.end() ? NULL : &(it->second);
 }
 
+CMasternodeMan::masternode_map_snapshot_t CMasternodeMan::GetMasternodeListSnapshot()
+{
+    if (fSnapshotStale) {
+        // Theses mutexes are recursive so double locking by the same thread is safe.
+        LOCK(cs);
+        // another reader may have republished while we were waiting for cs
+        if (fSnapshotStale) {
+            std::atomic_store(&pMasternodesSnapshot, masternode_map_snapshot_t(std::make_shared<masternode_map_t>(mapMasternodes)));
+            fSnapshotStale = false;
+        }
+    }
+    return std::atomic_load(&pMasternodesSnapshot);
+}
+
 bool CMasternodeMan::Get(const COutPoint& outpoint, CMasternode& masternodeRet)
 {
     // Theses mutexes are recursive so double locking by the same thread is safe.
@@ -456,7 +625,7 @@ bool CMasternodeMan::GetMasternodeInfo(const COutPoint& outpoint, masternode_inf
 bool CMasternodeMan::GetMasternodeInfo(const CPubKey& pubKeyMasternode, masternode_info_t& mnInfoRet)
 {
     LOCK(cs);
-    for (auto& mnpair : mapMasternodes) {
+    for (const auto& mnpair : mapMasternodes) {
         if (mnpair.second.pubKeyMasternode == pubKeyMasternode) {
             mnInfoRet = mnpair.second.GetInfo();
             return true;
@@ -468,7 +637,7 @@ bool CMasternodeMan::GetMasternodeInfo(const CPubKey& pubKeyMasternode, masterno
 bool CMasternodeMan::GetMasternodeInfo(const CScript& payee, masternode_info_t& mnInfoRet)
 {
     LOCK(cs);
-    for (auto& mnpair : mapMasternodes) {
+    for (const auto& mnpair : mapMasternodes) {
         CScript scriptCollateralAddress = GetScriptForDestination(mnpair.second.pubKeyCollateralAddress.GetID());
         if (scriptCollateralAddress == payee) {
             mnInfoRet = mnpair.second.GetInfo();
@@ -484,6 +653,60 @@ bool CMasternodeMan::Has(const COutPoint& outpoint)
     return mapMasternodes.find(outpoint) != mapMasternodes.end();
 }
 
+bool CMasternodeMan::HasSeenMasternodeBroadcast(const uint256& hash)
+{
+    LOCK(cs);
+    return mapSeenMasternodeBroadcast.count(hash) && !mMnbRecoveryRequests.count(hash);
+}
+
+bool CMasternodeMan::GetSeenMasternodeBroadcast(const uint256& hash, CMasternodeBroadcast& mnbRet)
+{
+    LOCK(cs);
+    auto it = mapSeenMasternodeBroadcast.find(hash);
+    if (it == mapSeenMasternodeBroadcast.end())
+        return false;
+    mnbRet = it->second.second;
+    return true;
+}
+
+void CMasternodeMan::RemoveSeenMasternodeBroadcast(const uint256& hash)
+{
+    LOCK(cs);
+    mapSeenMasternodeBroadcast.erase(hash);
+}
+
+bool CMasternodeMan::HasSeenMasternodePing(const uint256& hash)
+{
+    LOCK(cs);
+    return mapSeenMasternodePing.count(hash);
+}
+
+bool CMasternodeMan::GetSeenMasternodePing(const uint256& hash, CMasternodePing& mnpRet)
+{
+    LOCK(cs);
+    auto it = mapSeenMasternodePing.find(hash);
+    if (it == mapSeenMasternodePing.end())
+        return false;
+    mnpRet = it->second;
+    return true;
+}
+
+bool CMasternodeMan::HasSeenMasternodeVerification(const uint256& hash)
+{
+    LOCK(cs);
+    return mapSeenMasternodeVerification.count(hash);
+}
+
+bool CMasternodeMan::GetSeenMasternodeVerification(const uint256& hash, CMasternodeVerification& mnvRet)
+{
+    LOCK(cs);
+    auto it = mapSeenMasternodeVerification.find(hash);
+    if (it == mapSeenMasternodeVerification.end())
+        return false;
+    mnvRet = it->second;
+    return true;
+}
+
 //
 // Deterministically select the oldest/best masternode to pay on the network
 //
@@ -549,21 +772,17 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
     //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
     //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
     //  -- (chance per block * chances before IsScheduled will fire)
-    int nTenthNetwork = nMnCount/10;
-    int nCountTenth = 0;
-    arith_uint256 nHighest = 0;
-    CMasternode *pBestMasternode = NULL;
+    int nTenthNetwork = std::max(nMnCount/10, 1);
+    score_pair_vec_t vecMasternodeScores;
+    vecMasternodeScores.reserve(std::min((size_t)nTenthNetwork, vecMasternodeLastPaid.size()));
     BOOST_FOREACH (PAIRTYPE(int, CMasternode*)& s, vecMasternodeLastPaid){
-        arith_uint256 nScore = s.second->CalculateScore(blockHash);
-        if(nScore > nHighest){
-            nHighest = nScore;
-            pBestMasternode = s.second;
-        }
-        nCountTenth++;
-        if(nCountTenth >= nTenthNetwork) break;
+        vecMasternodeScores.push_back(std::make_pair(arith_uint256(), s.second));
+        if((int)vecMasternodeScores.size() >= nTenthNetwork) break;
     }
-    if (pBestMasternode) {
-        mnInfoRet = pBestMasternode->GetInfo();
+    ScoreMasternodes(blockHash, vecMasternodeScores);
+    // scores are hashes, a zero best score is as good as no winner
+    if (!vecMasternodeScores.empty() && vecMasternodeScores.front().first > 0) {
+        mnInfoRet = vecMasternodeScores.front().second->GetInfo();
     }
     return mnInfoRet.fInfoValid;
 }
@@ -623,17 +842,71 @@ bool CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, CMasternodeM
     if (mapMasternodes.empty())
         return false;
 
-    // calculate scores
+    vecMasternodeScoresRet.reserve(mapMasternodes.size());
     for (auto& mnpair : mapMasternodes) {
         if (mnpair.second.nProtocolVersion >= nMinProtocol) {
-            vecMasternodeScoresRet.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
+            vecMasternodeScoresRet.push_back(std::make_pair(arith_uint256(), &mnpair.second));
         }
     }
 
-    sort(vecMasternodeScoresRet.rbegin(), vecMasternodeScoresRet.rend(), CompareScoreMN());
+    ScoreMasternodes(nBlockHash, vecMasternodeScoresRet);
     return !vecMasternodeScoresRet.empty();
 }
 
+void CMasternodeMan::ScoreMasternodes(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScores)
+{
+    AssertLockHeld(cs);
+
+    if (vecMasternodeScores.empty())
+        return;
+
+    std::vector<CMasternodeScoreCheck> vChecks;
+    vChecks.reserve((vecMasternodeScores.size() + MASTERNODE_SCORE_SLICE_SIZE - 1) / MASTERNODE_SCORE_SLICE_SIZE);
+    for (size_t i = 0; i < vecMasternodeScores.size(); i += MASTERNODE_SCORE_SLICE_SIZE) {
+        size_t nEnd = std::min(i + MASTERNODE_SCORE_SLICE_SIZE, vecMasternodeScores.size());
+        vChecks.push_back(CMasternodeScoreCheck(&vecMasternodeScores[0] + i, &vecMasternodeScores[0] + nEnd, nBlockHash));
+    }
+
+    RunSharedChecks(GetSharedCheckQueue(), vChecks);
+
+    // every slice is sorted now, merge them pairwise into one ranking
+    for (size_t nWidth = MASTERNODE_SCORE_SLICE_SIZE; nWidth < vecMasternodeScores.size(); nWidth *= 2) {
+        for (size_t i = 0; i + nWidth < vecMasternodeScores.size(); i += 2 * nWidth) {
+            std::inplace_merge(vecMasternodeScores.begin() + i,
+                               vecMasternodeScores.begin() + i + nWidth,
+                               vecMasternodeScores.begin() + std::min(i + 2 * nWidth, vecMasternodeScores.size()),
+                               CompareScoreMNDescending());
+        }
+    }
+}
+
+CMasternodeMan::rank_table_ptr_t CMasternodeMan::GetRankTable(const uint256& nBlockHash, int nMinProtocol)
+{
+    AssertLockHeld(cs);
+
+    std::pair<uint256, int> key = std::make_pair(nBlockHash, nMinProtocol);
+    rank_table_ptr_t pRankTable;
+    if (mapRankTables.Get(key, pRankTable))
+        return pRankTable;
+
+    score_pair_vec_t vecMasternodeScores;
+    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+        return rank_table_ptr_t();
+
+    std::shared_ptr<CMasternodeRankTable> pNewRankTable = std::make_shared<CMasternodeRankTable>();
+    pNewRankTable->vecRankedOutpoints.reserve(vecMasternodeScores.size());
+    pNewRankTable->mapRanks.reserve(vecMasternodeScores.size());
+    int nRank = 0;
+    for (auto& scorePair : vecMasternodeScores) {
+        nRank++;
+        pNewRankTable->vecRankedOutpoints.push_back(scorePair.second->vin.prevout);
+        pNewRankTable->mapRanks.emplace(scorePair.second->vin.prevout, nRank);
+    }
+
+    mapRankTables.Insert(key, pNewRankTable);
+    return pNewRankTable;
+}
+
 bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet, int nBlockHeight, int nMinProtocol)
 {
     nRankRet = -1;
@@ -650,20 +923,12 @@ bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet,
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    rank_table_ptr_t pRankTable = GetRankTable(nBlockHash, nMinProtocol);
+    if (!pRankTable)
         return false;
 
-    int nRank = 0;
-    for (auto& scorePair : vecMasternodeScores) {
-        nRank++;
-        if(scorePair.second->vin.prevout == outpoint) {
-            nRankRet = nRank;
-            return true;
-        }
-    }
-
-    return false;
+    nRankRet = pRankTable->GetRank(outpoint);
+    return nRankRet != -1;
 }
 
 bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight, int nMinProtocol)
@@ -682,14 +947,16 @@ bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMast
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    rank_table_ptr_t pRankTable = GetRankTable(nBlockHash, nMinProtocol);
+    if (!pRankTable)
         return false;
 
+    vecMasternodeRanksRet.reserve(pRankTable->vecRankedOutpoints.size());
     int nRank = 0;
-    for (auto& scorePair : vecMasternodeScores) {
+    for (const auto& outpoint : pRankTable->vecRankedOutpoints) {
         nRank++;
-        vecMasternodeRanksRet.push_back(std::make_pair(nRank, *scorePair.second));
+        // Tables are dropped on every list change, so all ranked entries still exist
+        vecMasternodeRanksRet.push_back(std::make_pair(nRank, mapMasternodes.at(outpoint)));
     }
 
     return true;
@@ -749,71 +1016,26 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
         CMasternodeBroadcast mnb;
         vRecv >> mnb;
 
-        pfrom->setAskFor.erase(mnb.GetHash());
+        pfrom->RemoveAskFor(mnb.GetHash());
 
         if(!masternodeSync.IsBlockchainSynced()) return;
 
         LogPrint("masternode", "MNANNOUNCE -- Masternode announce, masternode=%s\n", mnb.vin.prevout.ToStringShort());
 
-        int nDos = 0;
-
-        if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
-            // use announced Masternode as a peer
-            connman.AddNewAddress(CAddress(mnb.addr, NODE_NETWORK), pfrom->addr, 2*60*60);
-        } else if(nDos > 0) {
-            Misbehaving(pfrom->GetId(), nDos);
-        }
+        QueuePendingMessage(CPendingMessage(pfrom, mnb), connman);
 
-        if(fMasternodesAdded) {
-            NotifyMasternodeUpdates(connman);
-        }
     } else if (strCommand == NetMsgType::MNPING) { //Masternode Ping
 
         CMasternodePing mnp;
         vRecv >> mnp;
 
-        uint256 nHash = mnp.GetHash();
-
-        pfrom->setAskFor.erase(nHash);
+        pfrom->RemoveAskFor(mnp.GetHash());
 
         if(!masternodeSync.IsBlockchainSynced()) return;
 
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s\n", mnp.vin.prevout.ToStringShort());
 
-        // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
-        LOCK2(cs_main, cs);
-
-        if(mapSeenMasternodePing.count(nHash)) return; //seen
-        mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
-
-        LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s new\n", mnp.vin.prevout.ToStringShort());
-
-        // see if we have this Masternode
-        CMasternode* pmn = Find(mnp.vin.prevout);
-
-        // if masternode uses sentinel ping instead of watchdog
-        // we shoud update nTimeLastWatchdogVote here if sentinel
-        // ping flag is actual
-        if(pmn && mnp.fSentinelIsCurrent)
-            UpdateWatchdogVoteTime(mnp.vin.prevout, mnp.sigTime);
-
-        // too late, new MNANNOUNCE is required
-        if(pmn && pmn->IsNewStartRequired()) return;
-
-        int nDos = 0;
-        if(mnp.CheckAndUpdate(pmn, false, nDos, connman)) return;
-
-        if(nDos > 0) {
-            // if anything significant failed, mark that node
-            Misbehaving(pfrom->GetId(), nDos);
-        } else if(pmn != NULL) {
-            // nothing significant failed, mn is a known one too
-            return;
-        }
-
-        // something significant is broken or mn is unknown,
-        // we might have to ask for a masternode entry once
-        AskForMN(pfrom, mnp.vin.prevout, connman);
+        QueuePendingMessage(CPendingMessage(pfrom, mnp), connman);
 
     } else if (strCommand == NetMsgType::DSEG) { //Get Masternode list or specific entry
         // Ignore such requests until we are fully synced.
@@ -861,7 +1083,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
             nInvCount++;
 
             mapSeenMasternodeBroadcast.insert(std::make_pair(hashMNB, std::make_pair(GetTime(), mnb)));
-            mapSeenMasternodePing.insert(std::make_pair(hashMNP, mnp));
+            AddSeenMasternodePing(mnp);
 
             if (vin.prevout == mnpair.first) {
                 LogPrintf("DSEG -- Sent 1 Masternode inv to peer %d\n", pfrom->id);
@@ -885,7 +1107,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
         CMasternodeVerification mnv;
         vRecv >> mnv;
 
-        pfrom->setAskFor.erase(mnv.GetHash());
+        pfrom->RemoveAskFor(mnv.GetHash());
 
         if(!masternodeSync.IsMasternodeListSynced()) return;
 
@@ -904,6 +1126,161 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
 // Verification of masternodes via unique direct requests.
 
+void CMasternodeMan::QueuePendingMessage(const CPendingMessage& msg, CConnman& connman)
+{
+    msg.pfrom->AddRef();
+    {
+        LOCK(cs_pending);
+        dequePendingMessages.push_back(msg);
+    }
+    ProcessPendingMessages(connman);
+}
+
+void CMasternodeMan::ProcessPendingMessages(CConnman& connman)
+{
+    while(true) {
+        {
+            // whoever is processing a batch takes our messages with the next one
+            TRY_LOCK(cs_process_pending, lockProcess);
+            if(!lockProcess) return;
+            while(ProcessPendingBatch(connman)) {}
+        }
+        // messages queued after the last batch was taken but before the lock was released
+        // found it held, they are ours now
+        LOCK(cs_pending);
+        if(dequePendingMessages.empty()) return;
+    }
+}
+
+bool CMasternodeMan::ProcessPendingBatch(CConnman& connman)
+{
+    AssertLockHeld(cs_process_pending);
+
+    std::deque<CPendingMessage> dequeBatch;
+    {
+        LOCK(cs_pending);
+        dequeBatch.swap(dequePendingMessages);
+    }
+    if(dequeBatch.empty()) return false;
+
+    // Messages we have seen already are dropped later on without looking at their
+    // signatures, and a ping can only be checked against a masternode we know of.
+    std::vector<CPubKey> vecPingKeys(dequeBatch.size());
+    std::vector<CMasternodeSigCheck> vChecks;
+    vChecks.reserve(dequeBatch.size() * 2);
+    {
+        LOCK(cs);
+        for (size_t i = 0; i < dequeBatch.size(); i++) {
+            const CPendingMessage& msg = dequeBatch[i];
+            if(msg.fPing) {
+                if(mapSeenMasternodePing.count(msg.mnp.GetHash())) continue;
+                CMasternode* pmn = Find(msg.mnp.vin.prevout);
+                if(!pmn) continue;
+                vecPingKeys[i] = pmn->pubKeyMasternode;
+                vChecks.push_back(CMasternodeSigCheck(vecPingKeys[i], msg.mnp.vchSig, msg.mnp.GetSignatureMessage()));
+            } else {
+                if(mapSeenMasternodeBroadcast.count(msg.mnb.GetHash())) continue;
+                vChecks.push_back(CMasternodeSigCheck(msg.mnb.pubKeyCollateralAddress, msg.mnb.vchSig, msg.mnb.GetSignatureMessage()));
+                if(msg.mnb.lastPing != CMasternodePing()) {
+                    vChecks.push_back(CMasternodeSigCheck(msg.mnb.pubKeyMasternode, msg.mnb.lastPing.vchSig, msg.mnb.lastPing.GetSignatureMessage()));
+                }
+            }
+        }
+    }
+
+    int64_t nTimeStart = GetTimeMicros();
+    RunSharedChecks(GetSharedCheckQueue(), vChecks);
+    int64_t nTimeVerify = GetTimeMicros() - nTimeStart;
+    nVerifyBatches++;
+    nVerifiedSignatures += vChecks.size();
+    nVerifyMicros += nTimeVerify;
+    LogPrint("masternode", "CMasternodeMan::ProcessPendingMessages -- checked %u signatures of %u messages in %.2fms\n",
+                vChecks.size(), dequeBatch.size(), nTimeVerify * 0.001);
+
+    BOOST_FOREACH(CPendingMessage& msg, dequeBatch) {
+        if(msg.fPing) {
+            ProcessMasternodePing(msg.pfrom, msg.mnp, connman);
+        } else {
+            ProcessMasternodeBroadcast(msg.pfrom, msg.mnb, connman);
+        }
+        msg.pfrom->Release();
+    }
+
+    if(fMasternodesAdded) {
+        NotifyMasternodeUpdates(connman);
+    }
+    return true;
+}
+
+void CMasternodeMan::ProcessMasternodeBroadcast(CNode* pfrom, const CMasternodeBroadcast& mnb, CConnman& connman)
+{
+    int nDos = 0;
+
+    if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
+        // use announced Masternode as a peer
+        connman.AddNewAddress(CAddress(mnb.addr, NODE_NETWORK), pfrom->addr, 2*60*60);
+    } else if(nDos > 0) {
+        LOCK(cs_main);
+        Misbehaving(pfrom->GetId(), nDos);
+    }
+}
+
+void CMasternodeMan::ProcessMasternodePing(CNode* pfrom, const CMasternodePing& mnpIn, CConnman& connman)
+{
+    CMasternodePing mnp(mnpIn);
+    uint256 nHash = mnp.GetHash();
+
+    // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
+    LOCK2(cs_main, cs);
+
+    if(!AddSeenMasternodePing(mnp)) return; //seen
+
+    LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s new\n", mnp.vin.prevout.ToStringShort());
+
+    // see if we have this Masternode
+    CMasternode* pmn = Find(mnp.vin.prevout);
+
+    // if masternode uses sentinel ping instead of watchdog
+    // we shoud update nTimeLastWatchdogVote here if sentinel
+    // ping flag is actual
+    if(pmn && mnp.fSentinelIsCurrent)
+        UpdateWatchdogVoteTime(mnp.vin.prevout, mnp.sigTime);
+
+    // too late, new MNANNOUNCE is required
+    if(pmn && pmn->IsNewStartRequired()) return;
+
+    int nDos = 0;
+    bool fUpdated = mnp.CheckAndUpdate(pmn, false, nDos, connman);
+    // CheckAndUpdate can take the new ping and re-check pmn before it fails
+    if(pmn) MarkSnapshotStale();
+    if(fUpdated) return;
+
+    if(nDos > 0) {
+        // if anything significant failed, mark that node
+        Misbehaving(pfrom->GetId(), nDos);
+    } else if(pmn != NULL) {
+        // nothing significant failed, mn is a known one too
+        return;
+    }
+
+    // something significant is broken or mn is unknown,
+    // we might have to ask for a masternode entry once
+    AskForMN(pfrom, mnp.vin.prevout, connman);
+}
+
+CMasternodeVerifyQueueStats CMasternodeMan::GetVerifyQueueStats()
+{
+    CMasternodeVerifyQueueStats stats;
+    {
+        LOCK(cs_pending);
+        stats.nQueued = dequePendingMessages.size();
+    }
+    stats.nBatches = nVerifyBatches;
+    stats.nVerified = nVerifiedSignatures;
+    stats.nVerifyMicros = nVerifyMicros;
+    return stats;
+}
+
 void CMasternodeMan::DoFullVerificationStep(CConnman& connman)
 {
     if(activeMasternode.outpoint == COutPoint()) return;
@@ -1029,12 +1406,14 @@ void CMasternodeMan::CheckSameAddr()
             }
             pprevMasternode = pmn;
         }
-    }
 
-    // ban duplicates
-    BOOST_FOREACH(CMasternode* pmn, vBan) {
-        LogPrintf("CMasternodeMan::CheckSameAddr -- increasing PoSe ban score for masternode %s\n", pmn->vin.prevout.ToStringShort());
-        pmn->IncreasePoSeBanScore();
+        // ban duplicates
+        BOOST_FOREACH(CMasternode* pmn, vBan) {
+            LogPrintf("CMasternodeMan::CheckSameAddr -- increasing PoSe ban score for masternode %s\n", pmn->vin.prevout.ToStringShort());
+            pmn->IncreasePoSeBanScore();
+        }
+        if(!vBan.empty())
+            MarkSnapshotStale();
     }
 }
 
@@ -1156,6 +1535,7 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
                     prealMasternode = &mnpair.second;
                     if(!mnpair.second.IsPoSeVerified()) {
                         mnpair.second.DecreasePoSeBanScore();
+                        MarkSnapshotStale();
                     }
                     netfulfilledman.AddFulfilledRequest(pnode->addr, strprintf("%s", NetMsgType::MNVERIFY)+"-done");
 
@@ -1181,7 +1561,7 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
                     }
 
                     mWeAskedForVerification[pnode->addr] = mnv;
-                    mapSeenMasternodeVerification.insert(std::make_pair(mnv.GetHash(), mnv));
+                    AddSeenMasternodeVerification(mnv);
                     mnv.Relay();
 
                 } else {
@@ -1205,9 +1585,11 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
             LogPrint("masternode", "CMasternodeMan::ProcessVerifyReply -- increased PoSe ban score for %s addr %s, new score %d\n",
                         prealMasternode->vin.prevout.ToStringShort(), pnode->addr.ToString(), pmn->nPoSeBanScore);
         }
-        if(!vpMasternodesToBan.empty())
+        if(!vpMasternodesToBan.empty()) {
+            MarkSnapshotStale();
             LogPrintf("CMasternodeMan::ProcessVerifyReply -- PoSe score increased for %d fake masternodes, addr %s\n",
                         (int)vpMasternodesToBan.size(), pnode->addr.ToString());
+        }
     }
 }
 
@@ -1219,7 +1601,7 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
         // we already have one
         return;
     }
-    mapSeenMasternodeVerification[mnv.GetHash()] = mnv;
+    AddSeenMasternodeVerification(mnv);
 
     // we don't care about history
     if(mnv.nBlockHeight < nCachedBlockHeight - MAX_POSE_BLOCKS) {
@@ -1292,8 +1674,10 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
             return;
         }
 
+        bool fChanged = false;
         if(!pmn1->IsPoSeVerified()) {
             pmn1->DecreasePoSeBanScore();
+            fChanged = true;
         }
         mnv.Relay();
 
@@ -1309,6 +1693,8 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
             LogPrint("masternode", "CMasternodeMan::ProcessVerifyBroadcast -- increased PoSe ban score for %s addr %s, new score %d\n",
                         mnpair.first.ToStringShort(), mnpair.second.addr.ToString(), mnpair.second.nPoSeBanScore);
         }
+        if(fChanged || nCount)
+            MarkSnapshotStale();
         if(nCount)
             LogPrintf("CMasternodeMan::ProcessVerifyBroadcast -- PoSe score increased for %d fake masternodes, addr %s\n",
                         nCount, pmn1->addr.ToString());
@@ -1331,7 +1717,7 @@ std::string CMasternodeMan::ToString() const
 void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman& connman)
 {
     LOCK2(cs_main, cs);
-    mapSeenMasternodePing.insert(std::make_pair(mnb.lastPing.GetHash(), mnb.lastPing));
+    AddSeenMasternodePing(mnb.lastPing);
     mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), std::make_pair(GetTime(), mnb)));
 
     LogPrintf("CMasternodeMan::UpdateMasternodeList -- masternode=%s  addr=%s\n", mnb.vin.prevout.ToStringShort(), mnb.addr.ToString());
@@ -1343,7 +1729,11 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman& co
         }
     } else {
         CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-        if(pmn->UpdateFromNewBroadcast(mnb, connman)) {
+        // UpdateFromNewBroadcast may change pmn even if it fails
+        bool fUpdated = pmn->UpdateFromNewBroadcast(mnb, connman);
+        MarkSnapshotStale();
+        if(fUpdated) {
+            InvalidateRankTables();
             masternodeSync.BumpAssetLastTime("CMasternodeMan::UpdateMasternodeList - seen");
             mapSeenMasternodeBroadcast.erase(mnbOld.GetHash());
         }
@@ -1405,7 +1795,10 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
         CMasternode* pmn = Find(mnb.vin.prevout);
         if(pmn) {
             CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-            if(!mnb.Update(pmn, nDos, connman)) {
+            // Update may re-check pmn or take the broadcast even if it fails
+            bool fUpdated = mnb.Update(pmn, nDos, connman);
+            MarkSnapshotStale();
+            if(!fUpdated) {
                 LogPrint("masternode", "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.vin.prevout.ToStringShort());
                 return false;
             }
@@ -1457,9 +1850,15 @@ void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
     // LogPrint("mnpayments", "CMasternodeMan::UpdateLastPaid -- nHeight=%d, nMaxBlocksToScanBack=%d, IsFirstRun=%s\n",
     //                         nCachedBlockHeight, nMaxBlocksToScanBack, IsFirstRun ? "true" : "false");
 
+    bool fChanged = false;
     for (auto& mnpair: mapMasternodes) {
+        int nBlockLastPaidPrev = mnpair.second.nBlockLastPaid;
         mnpair.second.UpdateLastPaid(pindex, nMaxBlocksToScanBack);
+        if (mnpair.second.nBlockLastPaid != nBlockLastPaidPrev)
+            fChanged = true;
     }
+    if (fChanged)
+        MarkSnapshotStale();
 
     IsFirstRun = false;
 }
@@ -1473,6 +1872,7 @@ void CMasternodeMan::UpdateWatchdogVoteTime(const COutPoint& outpoint, uint64_t
     }
     pmn->UpdateWatchdogVoteTime(nVoteTime);
     nLastWatchdogVoteTime = GetTime();
+    MarkSnapshotStale();
 }
 
 bool CMasternodeMan::IsWatchdogActive()
@@ -1490,15 +1890,21 @@ bool CMasternodeMan::AddGovernanceVote(const COutPoint& outpoint, uint256 nGover
         return false;
     }
     pmn->AddGovernanceVote(nGovernanceObjectHash);
+    MarkSnapshotStale();
     return true;
 }
 
 void CMasternodeMan::RemoveGovernanceObject(uint256 nGovernanceObjectHash)
 {
     LOCK(cs);
+    bool fChanged = false;
     for(auto& mnpair : mapMasternodes) {
+        if(!mnpair.second.mapGovernanceObjectsVotedOn.count(nGovernanceObjectHash)) continue;
         mnpair.second.RemoveGovernanceObject(nGovernanceObjectHash);
+        fChanged = true;
     }
+    if(fChanged)
+        MarkSnapshotStale();
 }
 
 void CMasternodeMan::CheckMasternode(const CPubKey& pubKeyMasternode, bool fForce)
@@ -1506,7 +1912,8 @@ void CMasternodeMan::CheckMasternode(const CPubKey& pubKeyMasternode, bool fForc
     LOCK(cs);
     for (auto& mnpair : mapMasternodes) {
         if (mnpair.second.pubKeyMasternode == pubKeyMasternode) {
-            mnpair.second.Check(fForce);
+            if (CheckEntry(mnpair.second, fForce))
+                MarkSnapshotStale();
             return;
         }
     }
@@ -1527,13 +1934,14 @@ void CMasternodeMan::SetMasternodeLastPing(const COutPoint& outpoint, const CMas
         return;
     }
     pmn->lastPing = mnp;
+    MarkSnapshotStale();
     // if masternode uses sentinel ping instead of watchdog
     // we shoud update nTimeLastWatchdogVote here if sentinel
     // ping flag is actual
     if(mnp.fSentinelIsCurrent) {
         UpdateWatchdogVoteTime(mnp.vin.prevout, mnp.sigTime);
     }
-    mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
+    AddSeenMasternodePing(mnp);
 
     CMasternodeBroadcast mnb(*pmn);
     uint256 hash = mnb.GetHash();
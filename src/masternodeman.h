@@ -5,9 +5,18 @@
 #ifndef MASTERNODEMAN_H
 #define MASTERNODEMAN_H
 
+#include "cachemap.h"
+#include "coins.h"
+#include "expirywheel.h"
 #include "masternode.h"
+#include "saltedhasher.h"
 #include "sync.h"
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
 using namespace std;
 
 class CMasternodeMan;
@@ -15,6 +24,34 @@ class CConnman;
 
 extern CMasternodeMan mnodeman;
 
+/** Depth and throughput of the masternode announce and ping verify queue */
+struct CMasternodeVerifyQueueStats
+{
+    size_t nQueued;
+    uint64_t nBatches;
+    uint64_t nVerified;
+    int64_t nVerifyMicros;
+};
+
+/**
+ * Ranks of all masternodes for one block hash and minimum protocol version.
+ * Built once from the sorted scores and then answers rank queries per outpoint
+ * in O(1) until the masternode list changes.
+ */
+class CMasternodeRankTable
+{
+public:
+    /// Outpoints in rank order, rank n is at index n - 1
+    std::vector<COutPoint> vecRankedOutpoints;
+    std::unordered_map<COutPoint, int, SaltedOutpointHasher> mapRanks;
+
+    int GetRank(const COutPoint& outpoint) const
+    {
+        std::unordered_map<COutPoint, int, SaltedOutpointHasher>::const_iterator it = mapRanks.find(outpoint);
+        return it == mapRanks.end() ? -1 : it->second;
+    }
+};
+
 class CMasternodeMan
 {
 public:
@@ -22,12 +59,21 @@ public:
     typedef std::vector<score_pair_t> score_pair_vec_t;
     typedef std::pair<int, CMasternode> rank_pair_t;
     typedef std::vector<rank_pair_t> rank_pair_vec_t;
+    typedef std::shared_ptr<const CMasternodeRankTable> rank_table_ptr_t;
+    typedef std::map<COutPoint, CMasternode> masternode_map_t;
+    typedef std::shared_ptr<const masternode_map_t> masternode_map_snapshot_t;
 
 private:
     static const std::string SERIALIZATION_VERSION_STRING;
 
+    /// Number of (block hash, min protocol) rank tables kept around
+    static const int RANK_TABLE_CACHE_SIZE      = 64;
+
     static const int DSEG_UPDATE_SECONDS        = 3 * 60 * 60;
 
+    /// Width of the buckets timed entries are expired in
+    static const int EXPIRY_BUCKET_SECONDS      = 60;
+
     static const int LAST_PAID_SCAN_BLOCKS      = 100;
 
     static const int MIN_POSE_PROTO_VERSION     = 70203;
@@ -41,6 +87,18 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    /// An announce or ping waiting for its signature check, holds a reference to the peer it came from
+    struct CPendingMessage
+    {
+        CNode* pfrom;
+        bool fPing;
+        CMasternodeBroadcast mnb;
+        CMasternodePing mnp;
+
+        CPendingMessage(CNode* pfromIn, const CMasternodeBroadcast& mnbIn) : pfrom(pfromIn), fPing(false), mnb(mnbIn) {}
+        CPendingMessage(CNode* pfromIn, const CMasternodePing& mnpIn) : pfrom(pfromIn), fPing(true), mnp(mnpIn) {}
+    };
+
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -55,7 +113,7 @@ private:
     // who we asked for the Masternode list and the last time
     std::map<CNetAddr, int64_t> mWeAskedForMasternodeList;
     // which Masternodes we've asked for
-    std::map<COutPoint, std::map<CNetAddr, int64_t> > mWeAskedForMasternodeListEntry;
+    std::unordered_map<COutPoint, std::map<CNetAddr, int64_t>, SaltedOutpointHasher> mWeAskedForMasternodeListEntry;
     // who we asked for the masternode verification
     std::map<CNetAddr, CMasternodeVerification> mWeAskedForVerification;
 
@@ -74,19 +132,68 @@ private:
 
     int64_t nLastWatchdogVoteTime;
 
+    /// Rank tables by (block hash, min protocol), cleared whenever mapMasternodes changes
+    CacheMap<std::pair<uint256, int>, rank_table_ptr_t> mapRankTables;
+
+    /// Immutable copy of mapMasternodes handed out to readers, only accessed through std::atomic_load/store
+    masternode_map_snapshot_t pMasternodesSnapshot;
+    /// Set by every change to mapMasternodes or its entries, cleared when pMasternodesSnapshot is republished
+    std::atomic<bool> fSnapshotStale;
+
+    // protects dequePendingMessages only, never held while taking cs
+    CCriticalSection cs_pending;
+    std::deque<CPendingMessage> dequePendingMessages;
+    // held while a batch is verified and processed, so batches are applied in the order they arrived
+    CCriticalSection cs_process_pending;
+    std::atomic<uint64_t> nVerifyBatches;
+    std::atomic<uint64_t> nVerifiedSignatures;
+    std::atomic<int64_t> nVerifyMicros;
+
+    /// When the entries of mWeAskedForMasternodeListEntry, mapSeenMasternodePing and
+    /// mapSeenMasternodeVerification are due, so CheckAndRemove only visits those
+    CExpiryWheel<COutPoint> wheelWeAskedForMasternodeListEntry;
+    CExpiryWheel<uint256> wheelSeenMasternodePing;
+    /// Keyed by block height instead of time
+    CExpiryWheel<uint256> wheelSeenMasternodeVerification;
+
     friend class CMasternodeSync;
     /// Find an entry
     CMasternode* Find(const COutPoint& outpoint);
 
     bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
+    /// Score the masternodes in vecMasternodeScores for nBlockHash and sort them highest first, on the shared check threads when they are free
+    void ScoreMasternodes(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScores);
+    /// Get the cached rank table for nBlockHash, computing it if needed; NULL if there are no ranks
+    rank_table_ptr_t GetRankTable(const uint256& nBlockHash, int nMinProtocol);
+
+    /// Must be called with cs held by everything that modifies mapMasternodes or one of its entries.
+    /// Only marks the copy, it is rebuilt by the next full-list reader, so a batch of writes costs one copy.
+    void MarkSnapshotStale()
+    {
+        AssertLockHeld(cs);
+        fSnapshotStale = true;
+    }
+
+    /// Check() an entry, true if its state or PoSe ban score changed
+    bool CheckEntry(CMasternode& mn, bool fForce = false);
+
+    void AddSeenMasternodeVerification(const CMasternodeVerification& mnv);
+    /// Fill the expiry wheels from scratch, after loading mncache.dat
+    void RebuildExpiryWheels();
+
+    void QueuePendingMessage(const CPendingMessage& msg, CConnman& connman);
+    /// Verify and process everything queued so far, false if the queue was empty
+    bool ProcessPendingBatch(CConnman& connman);
+    void ProcessMasternodeBroadcast(CNode* pfrom, const CMasternodeBroadcast& mnb, CConnman& connman);
+    void ProcessMasternodePing(CNode* pfrom, const CMasternodePing& mnp, CConnman& connman);
 
 public:
     // Keep track of all broadcasts I've seen
-    std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
-    // Keep track of all pings I've seen
-    std::map<uint256, CMasternodePing> mapSeenMasternodePing;
+    std::unordered_map<uint256, std::pair<int64_t, CMasternodeBroadcast>, SaltedTxidHasher> mapSeenMasternodeBroadcast;
+    // Keep track of all pings I've seen, only add to it through AddSeenMasternodePing
+    std::unordered_map<uint256, CMasternodePing, SaltedTxidHasher> mapSeenMasternodePing;
     // Keep track of all verifications I've seen
-    std::map<uint256, CMasternodeVerification> mapSeenMasternodeVerification;
+    std::unordered_map<uint256, CMasternodeVerification, SaltedTxidHasher> mapSeenMasternodeVerification;
     // keep track of dsq count to prevent masternodes from gaming darksend queue
     int64_t nDsqCount;
 
@@ -119,6 +226,11 @@ public:
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
+        if(ser_action.ForRead()) {
+            InvalidateRankTables();
+            MarkSnapshotStale();
+            RebuildExpiryWheels();
+        }
     }
 
     CMasternodeMan();
@@ -126,6 +238,9 @@ public:
     /// Add an entry
     bool Add(CMasternode &mn);
 
+    /// Remember a ping as seen, returns false if it was seen before
+    bool AddSeenMasternodePing(const CMasternodePing& mnp);
+
     /// Ask (source) node for mnb
     void AskForMN(CNode *pnode, const COutPoint& outpoint, CConnman& connman);
     void AskForMnb(CNode *pnode, const uint256 &hash);
@@ -161,6 +276,15 @@ public:
     bool Get(const COutPoint& outpoint, CMasternode& masternodeRet);
     bool Has(const COutPoint& outpoint);
 
+    /// Look up the seen-maps under cs, they are written from the message handler and ThreadCheckPrivateSend
+    bool HasSeenMasternodeBroadcast(const uint256& hash);
+    bool GetSeenMasternodeBroadcast(const uint256& hash, CMasternodeBroadcast& mnbRet);
+    void RemoveSeenMasternodeBroadcast(const uint256& hash);
+    bool HasSeenMasternodePing(const uint256& hash);
+    bool GetSeenMasternodePing(const uint256& hash, CMasternodePing& mnpRet);
+    bool HasSeenMasternodeVerification(const uint256& hash);
+    bool GetSeenMasternodeVerification(const uint256& hash, CMasternodeVerification& mnvRet);
+
     bool GetMasternodeInfo(const COutPoint& outpoint, masternode_info_t& mnInfoRet);
     bool GetMasternodeInfo(const CPubKey& pubKeyMasternode, masternode_info_t& mnInfoRet);
     bool GetMasternodeInfo(const CScript& payee, masternode_info_t& mnInfoRet);
@@ -173,7 +297,12 @@ public:
     /// Find a random entry
     masternode_info_t FindRandomNotInVec(const std::vector<COutPoint> &vecToExclude, int nProtocolVersion = -1);
 
-    std::map<COutPoint, CMasternode> GetFullMasternodeMap() { return mapMasternodes; }
+    /**
+     * Consistent read-only view of the whole masternode list, for readers that walk all of it.
+     * They share one copy and only take cs to rebuild it after the list changed. Lookups of
+     * single entries go to mapMasternodes under cs instead, they'd copy the list after every ping.
+     */
+    masternode_map_snapshot_t GetMasternodeListSnapshot();
 
     bool GetMasternodeRanks(rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight = -1, int nMinProtocol = 0);
     bool GetMasternodeRank(const COutPoint &outpoint, int& nRankRet, int nBlockHeight = -1, int nMinProtocol = 0);
@@ -183,6 +312,15 @@ public:
 
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 
+    /**
+     * Check the signatures of all queued announces and pings, on the shared check
+     * threads when they are free, and then process the messages one by one in the
+     * order they arrived. Returns right away if another thread is at it, that thread
+     * takes whatever was queued meanwhile as its next batch.
+     */
+    void ProcessPendingMessages(CConnman& connman);
+    CMasternodeVerifyQueueStats GetVerifyQueueStats();
+
     void DoFullVerificationStep(CConnman& connman);
     void CheckSameAddr();
     bool SendVerifyRequest(const CAddress& addr, const std::vector<CMasternode*>& vSortedByAddr, CConnman& connman);
@@ -199,10 +337,18 @@ public:
     void UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman& connman);
     /// Perform complete check and only then update list and maps
     bool CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBroadcast mnb, int& nDos, CConnman& connman);
-    bool IsMnbRecoveryRequested(const uint256& hash) { return mMnbRecoveryRequests.count(hash); }
+    bool IsMnbRecoveryRequested(const uint256& hash) { LOCK(cs); return mMnbRecoveryRequests.count(hash); }
 
     void UpdateLastPaid(const CBlockIndex* pindex);
 
+    /// Drop cached rank tables, must be called whenever entries are added,
+    /// removed or change their protocol version
+    void InvalidateRankTables()
+    {
+        LOCK(cs);
+        mapRankTables.Clear();
+    }
+
     void AddDirtyGovernanceObjectHash(const uint256& nHash)
     {
         LOCK(cs);
@@ -7,8 +7,34 @@
 #include "validation.h" // For strMessageMagic
 #include "messagesigner.h"
 #include "tinyformat.h"
+#include "util.h"
 #include "utilstrencodings.h"
 
+namespace {
+
+/**
+ * Signatures of special messages (mnb, mnp, governance objects and votes,
+ * txlvote) already known to be valid. The same message is verified again
+ * whenever it is relayed back to us, re-requested during mnb recovery or
+ * re-checked on sync, and each of those would otherwise repeat the public
+ * key recovery.
+ */
+static CSaltedSignatureCache<uint256> messageSignatureCache;
+}
+
+void InitMessageSignatureCache()
+{
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, GetArg("-maxmsgsigcachesize", DEFAULT_MAX_MSG_SIG_CACHE_SIZE)), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = messageSignatureCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for message signature cache, able to store %zu elements\n",
+            messageSignatureCache.GetStats().nBytes >> 20, nMaxCacheSize>>20, nElems);
+}
+
+CSignatureCacheStats GetMessageSignatureCacheStats()
+{
+    return messageSignatureCache.GetStats();
+}
+
 bool CMessageSigner::GetKeysFromSecret(const std::string strSecret, CKey& keyRet, CPubKey& pubkeyRet)
 {
     CBitcoinSecret vchSecret;
@@ -46,6 +72,10 @@ bool CHashSigner::SignHash(const uint256& hash, const CKey key, std::vector<unsi
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
+    uint256 entry;
+    messageSignatureCache.ComputeEntry(entry, hash, vchSig, pubkey);
+    if(messageSignatureCache.Get(entry, false)) return true;
+
     CPubKey pubkeyFromSig;
     if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
         strErrorRet = "Error recovering public key.";
@@ -59,5 +89,6 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey pubkey, const st
         return false;
     }
 
+    messageSignatureCache.Set(entry);
     return true;
 }
@@ -6,6 +6,10 @@
 #define MESSAGESIGNER_H
 
 #include "key.h"
+#include "script/sigcache.h"
+
+//! Memory reserved for known valid special-message signatures, in MiB
+static const unsigned int DEFAULT_MAX_MSG_SIG_CACHE_SIZE = 8;
 
 /** Helper class for signing messages and checking their signatures
  */
@@ -31,4 +35,8 @@ public:
     static bool VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
 };
 
+/** Allocate the cache of valid mnb/mnp/governance/txlvote signatures, sized by -maxmsgsigcachesize */
+void InitMessageSignatureCache();
+CSignatureCacheStats GetMessageSignatureCacheStats();
+
 #endif
@@ -387,6 +387,8 @@ public:
 
 
     unsigned int GetReceiveFloodSize() const;
+
+    void WakeMessageHandler();
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -404,8 +406,6 @@ private:
     void ThreadDNSAddressSeed();
     void ThreadMnbRequestConnections();
 
-    void WakeMessageHandler();
-
     CNode* FindNode(const CNetAddr& ip);
     CNode* FindNode(const CSubNet& subNet);
     CNode* FindNode(const std::string& addrName);
@@ -690,6 +690,8 @@ public:
     CCriticalSection cs_vProcessMsg;
     std::list<CNetMessage> vProcessMsg;
     size_t nProcessQueueSize;
+    // special messages waiting for a worker thread (see ThreadSpecialMessageWorker)
+    std::atomic<int> nSpecialMessagesQueued;
 
     std::deque<CInv> vRecvGetData;
     uint64_t nRecvBytes;
@@ -755,6 +757,7 @@ public:
     CRollingBloomFilter filterInventoryKnown;
     std::vector<CInv> vInventoryToSend;
     CCriticalSection cs_inventory;
+    // Also protected by cs_inventory, special messages forget their hash from worker threads
     std::set<uint256> setAskFor;
     std::multimap<int64_t, CInv> mapAskFor;
     int64_t nNextInvSend;
@@ -904,6 +907,7 @@ public:
     }
 
     void AskFor(const CInv& inv);
+    void RemoveAskFor(const uint256& hash);
 
     void CloseSocketDisconnect();
 
@@ -14,6 +14,13 @@
 static constexpr int64_t HEADERS_DOWNLOAD_TIMEOUT_BASE = 15 * 60 * 1000000; // 15 minutes
 static constexpr int64_t HEADERS_DOWNLOAD_TIMEOUT_PER_HEADER = 1000; // 1ms/header
 
+/** Default number of threads handling governance and InstantSend vote messages */
+static const int DEFAULT_SPECIAL_MESSAGE_THREADS = 2;
+/** Maximum number of special message threads */
+static const int MAX_SPECIAL_MESSAGE_THREADS = 16;
+/** Stop processing a peer's messages while this many of its special messages wait for a worker */
+static const int MAX_SPECIAL_MESSAGES_QUEUED = 100;
+
 /** Register with a network node to receive its signals */
 void RegisterNodeSignals(CNodeSignals& nodeSignals);
 /** Unregister a network node */
@@ -54,4 +61,20 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
  */
 bool SendMessages(CNode* pto, CConnman& connman, std::atomic<bool>& interrupt);
 
+/**
+ * Set up nThreads special message workers. Governance messages and InstantSend votes are
+ * then handed to the worker of the sending peer instead of being processed on the message
+ * handler thread. Must be called before the workers and the message handler are started.
+ */
+void InitSpecialMessageWorkers(int nThreads);
+/** Drop the workers and the messages still queued for them, once their threads have stopped */
+void ClearSpecialMessageWorkers();
+/** Run a special message worker, see InitSpecialMessageWorkers */
+void ThreadSpecialMessageWorker(int nWorker);
+/**
+ * Process a masternode, governance, InstantSend, PrivateSend or spork message, or queue it for
+ * the worker of the sending peer if it is one the workers take. Returns true if it was queued.
+ */
+bool ProcessOrQueueSpecialMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman);
+
 #endif // BITCOIN_NET_PROCESSING_H
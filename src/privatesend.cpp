@@ -410,29 +410,30 @@ void CPrivateSend::UpdatedBlockTip(const CBlockIndex *pindex)
     }
 }
 
-void CPrivateSend::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
+void CPrivateSend::BlockConnected(const CBlock& block, const CBlockIndex* pindex)
 {
-    if (tx.IsCoinBase()) return;
-
-    LOCK2(cs_main, cs_mapdstx);
-
-    uint256 txHash = tx.GetHash();
-    if (!mapDSTX.count(txHash)) return;
-
-    // When tx is 0-confirmed or conflicted, pblock is NULL and nConfirmedHeight should be set to -1
-    CBlockIndex* pblockindex = NULL;
-    if(pblock) {
-        uint256 blockHash = pblock->GetHash();
-        BlockMap::iterator mi = mapBlockIndex.find(blockHash);
-        if(mi == mapBlockIndex.end() || !mi->second) {
-            // shouldn't happen
-            LogPrint("privatesend", "CPrivateSendClient::SyncTransaction -- Failed to find block %s\n", blockHash.ToString());
-            return;
-        }
-        pblockindex = mi->second;
+    UpdateDSTXConfirmedHeights(block, pindex->nHeight);
+}
+
+void CPrivateSend::BlockDisconnected(const CBlock& block)
+{
+    // Transactions of a disconnected block are 0-confirmed again
+    UpdateDSTXConfirmedHeights(block, -1);
+}
+
+void CPrivateSend::UpdateDSTXConfirmedHeights(const CBlock& block, int nHeight)
+{
+    LOCK(cs_mapdstx);
+
+    if (mapDSTX.empty()) return;
+
+    BOOST_FOREACH(const CTransaction& tx, block.vtx) {
+        if (tx.IsCoinBase()) continue;
+        std::map<uint256, CDarksendBroadcastTx>::iterator it = mapDSTX.find(tx.GetHash());
+        if (it == mapDSTX.end()) continue;
+        it->second.SetConfirmedHeight(nHeight);
+        LogPrint("privatesend", "CPrivateSend::UpdateDSTXConfirmedHeights -- txid=%s nHeight=%d\n", it->first.ToString(), nHeight);
     }
-    mapDSTX[txHash].SetConfirmedHeight(pblockindex ? pblockindex->nHeight : -1);
-    LogPrint("privatesend", "CPrivateSendClient::SyncTransaction -- txid=%s\n", txHash.ToString());
 }
 
 //TODO: Rename/move to core
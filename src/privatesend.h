@@ -319,6 +319,7 @@ private:
     static CCriticalSection cs_mapdstx;
 
     static void CheckDSTXes(int nHeight);
+    static void UpdateDSTXConfirmedHeights(const CBlock& block, int nHeight);
 
 public:
     static void InitStandardDenominations();
@@ -353,7 +354,8 @@ public:
     static CDarksendBroadcastTx GetDSTX(const uint256& hash);
 
     static void UpdatedBlockTip(const CBlockIndex *pindex);
-    static void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
+    static void BlockConnected(const CBlock& block, const CBlockIndex* pindex);
+    static void BlockDisconnected(const CBlock& block);
 };
 
 void ThreadCheckPrivateSend(CConnman& connman);
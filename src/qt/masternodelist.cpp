@@ -292,10 +292,10 @@ void MasternodeList::updateNodeList()
     ui->tableWidgetMasternodes->setSortingEnabled(false);
     ui->tableWidgetMasternodes->clearContents();
     ui->tableWidgetMasternodes->setRowCount(0);
-    std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
+    CMasternodeMan::masternode_map_snapshot_t pMasternodes = mnodeman.GetMasternodeListSnapshot();
     int offsetFromUtc = GetOffsetFromUtc();
 
-    for(auto& mnpair : mapMasternodes)
+    for(const auto& mnpair : *pMasternodes)
     {
         CMasternode mn = mnpair.second;
         // populate list
@@ -14,6 +14,7 @@
 #include "policy/policy.h"
 #include "primitives/transaction.h"
 #include "rpc/server.h"
+#include "script/sigcache.h"
 #include "streams.h"
 #include "sync.h"
 #include "txdb.h"
@@ -21,6 +22,7 @@
 #include "util.h"
 #include "utilstrencodings.h"
 #include "hash.h"
+#include "messagesigner.h"
 
 #include <stdint.h>
 
@@ -1058,6 +1060,44 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
     return mempoolInfoToJSON();
 }
 
+static UniValue sigCacheStatsToJSON(const CSignatureCacheStats& stats)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("bytes", (uint64_t)stats.nBytes));
+    ret.push_back(Pair("capacity", (uint64_t)stats.nElements));
+    ret.push_back(Pair("lookups", stats.nLookups));
+    ret.push_back(Pair("hits", stats.nHits));
+    ret.push_back(Pair("hitrate", stats.nLookups ? (double)stats.nHits / stats.nLookups : 0.0));
+    return ret;
+}
+
+UniValue getsigcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getsigcacheinfo\n"
+            "\nReturns the size and hit rate of the signature verification caches.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"bytes\": xxxxx,              (numeric) Memory allocated for the script cache, about -maxsigcachesize\n"
+            "  \"capacity\": xxxxx,           (numeric) Maximum number of signatures the cache can hold\n"
+            "  \"lookups\": xxxxx,            (numeric) Signature checks that consulted the cache since startup\n"
+            "  \"hits\": xxxxx,               (numeric) Lookups that found a previously verified signature\n"
+            "  \"hitrate\": x.xxx,            (numeric) hits / lookups, 0 if there were no lookups\n"
+            "  \"messages\": {                (json object) The same for masternode, governance and InstantSend\n"
+            "    ...                          message signatures (-maxmsgsigcachesize)\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getsigcacheinfo", "")
+            + HelpExampleRpc("getsigcacheinfo", "")
+        );
+
+    UniValue ret = sigCacheStatsToJSON(GetSignatureCacheStats());
+    ret.push_back(Pair("messages", sigCacheStatsToJSON(GetMessageSignatureCacheStats())));
+    return ret;
+}
+
 UniValue invalidateblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -37,7 +37,7 @@ UniValue gobject(const UniValue& params, bool fHelp)
          strCommand != "prepare" &&
 #endif // ENABLE_WALLET
          strCommand != "vote-many" && strCommand != "vote-conf" && strCommand != "vote-alias" && strCommand != "submit" && strCommand != "count" &&
-         strCommand != "deserialize" && strCommand != "get" && strCommand != "getvotes" && strCommand != "getcurrentvotes" && strCommand != "list" && strCommand != "diff" &&
+         strCommand != "deserialize" && strCommand != "get" && strCommand != "getvotes" && strCommand != "getcurrentvotes" && strCommand != "getmasternodevotes" && strCommand != "list" && strCommand != "diff" &&
          strCommand != "check" ))
         throw std::runtime_error(
                 "gobject \"command\"...\n"
@@ -53,6 +53,7 @@ UniValue gobject(const UniValue& params, bool fHelp)
                 "  get                - Get governance object by hash\n"
                 "  getvotes           - Get all votes for a governance object hash (including old votes)\n"
                 "  getcurrentvotes    - Get only current (tallying) votes for a governance object hash (does not include old votes)\n"
+                "  getmasternodevotes - Get all votes cast by a masternode, grouped by governance object hash\n"
                 "  list               - List governance objects (can be filtered by signal and/or object type)\n"
                 "  diff               - List differences since last diff\n"
                 "  vote-alias         - Vote on a governance object by masternode alias (using masternode.conf setup)\n"
@@ -841,6 +842,42 @@ UniValue gobject(const UniValue& params, bool fHelp)
         return bResult;
     }
 
+    // GETVOTES FROM SPECIFIC MASTERNODE ACROSS ALL GOVERNANCE OBJECTS
+    if(strCommand == "getmasternodevotes")
+    {
+        if (params.size() != 3)
+            throw std::runtime_error(
+                "Correct usage is 'gobject getmasternodevotes <txid> <vout_index>'"
+                );
+
+        // COLLECT PARAMETERS FROM USER
+
+        uint256 txid = ParseHashV(params[1], "Masternode Collateral hash");
+        std::string strVout = params[2].get_str();
+        uint32_t vout = boost::lexical_cast<uint32_t>(strVout);
+        COutPoint mnCollateralOutpoint(txid, vout);
+
+        // REPORT RESULTS TO USER
+
+        std::map<uint256, UniValue> mapResults;
+
+        std::vector<CGovernanceVote> vecVotes = governance.GetMasternodeVotes(mnCollateralOutpoint);
+        BOOST_FOREACH(CGovernanceVote vote, vecVotes) {
+            std::map<uint256, UniValue>::iterator it = mapResults.find(vote.GetParentHash());
+            if(it == mapResults.end()) {
+                it = mapResults.insert(std::make_pair(vote.GetParentHash(), UniValue(UniValue::VOBJ))).first;
+            }
+            it->second.push_back(Pair(vote.GetHash().ToString(),  vote.ToString()));
+        }
+
+        UniValue bResult(UniValue::VOBJ);
+        for(std::map<uint256, UniValue>::iterator it = mapResults.begin(); it != mapResults.end(); ++it) {
+            bResult.push_back(Pair(it->first.ToString(), it->second));
+        }
+
+        return bResult;
+    }
+
     return NullUniValue;
 }
 
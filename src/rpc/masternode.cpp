@@ -126,7 +126,7 @@ UniValue masternode(const UniValue& params, bool fHelp)
 #endif // ENABLE_WALLET
          strCommand != "list" && strCommand != "list-conf" && strCommand != "count" &&
          strCommand != "debug" && strCommand != "current" && strCommand != "winner" && strCommand != "winners" && strCommand != "genkey" &&
-         strCommand != "connect" && strCommand != "status"))
+         strCommand != "connect" && strCommand != "status" && strCommand != "verifyqueue"))
             throw std::runtime_error(
                 "masternode \"command\"...\n"
                 "Set of commands to execute masternode related actions\n"
@@ -144,6 +144,7 @@ UniValue masternode(const UniValue& params, bool fHelp)
                 "  status       - Print masternode status information\n"
                 "  list         - Print list of all known masternodes (see masternodelist for more info)\n"
                 "  list-conf    - Print masternode.conf in JSON format\n"
+                "  verifyqueue  - Print depth and throughput of the masternode announce and ping verify queue\n"
                 "  winner       - Print info on next masternode winner to vote for\n"
                 "  winners      - Print list of masternode winners\n"
                 );
@@ -401,6 +402,19 @@ UniValue masternode(const UniValue& params, bool fHelp)
         return mnObj;
     }
 
+    if (strCommand == "verifyqueue")
+    {
+        CMasternodeVerifyQueueStats stats = mnodeman.GetVerifyQueueStats();
+
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("queued", (uint64_t)stats.nQueued));
+        obj.push_back(Pair("batches", stats.nBatches));
+        obj.push_back(Pair("verified", stats.nVerified));
+        obj.push_back(Pair("verifytime", stats.nVerifyMicros * 0.000001));
+        obj.push_back(Pair("verifiedpersecond", stats.nVerifyMicros ? stats.nVerified * 1000000.0 / stats.nVerifyMicros : 0.0));
+        return obj;
+    }
+
     if (strCommand == "winners")
     {
         int nHeight;
@@ -501,8 +515,8 @@ UniValue masternodelist(const UniValue& params, bool fHelp)
             obj.push_back(Pair(strOutpoint, s.first));
         }
     } else {
-        std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
-        for (auto& mnpair : mapMasternodes) {
+        CMasternodeMan::masternode_map_snapshot_t pMasternodes = mnodeman.GetMasternodeListSnapshot();
+        for (const auto& mnpair : *pMasternodes) {
             CMasternode mn = mnpair.second;
             std::string strOutpoint = mnpair.first.ToStringShort();
             if (strMode == "activeseconds") {
@@ -589,6 +589,65 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+/** Read the optional "limit" and "cursor" of a paged address index query, returns false if it isn't paged */
+template <typename Key>
+bool getPagingFromParams(const UniValue& params, const std::vector<std::pair<uint160, int> > &addresses,
+                         size_t &nLimit, Key &nextKey)
+{
+    if (!params[0].isObject())
+        return false;
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+
+    if (limitValue.isNull()) {
+        if (!cursorValue.isNull()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor is only valid together with a limit");
+        }
+        return false;
+    }
+    if (!limitValue.isNum() || limitValue.get_int() <= 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be a positive number");
+    }
+    if (addresses.size() != 1) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Paging is only supported for a single address");
+    }
+    nLimit = limitValue.get_int();
+
+    if (!cursorValue.isNull()) {
+        if (!cursorValue.isStr() || !IsHex(cursorValue.get_str())) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        std::vector<unsigned char> vchCursor = ParseHex(cursorValue.get_str());
+        CDataStream ssCursor(vchCursor, SER_DISK, CLIENT_VERSION);
+        try {
+            ssCursor >> nextKey;
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        if (!ssCursor.empty() || nextKey.txhash.IsNull() ||
+            (int)nextKey.type != addresses[0].second || nextKey.hashBytes != addresses[0].first) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+    }
+
+    return true;
+}
+
+/** Wrap one page of results together with the cursor of the next page, if there is one */
+template <typename Key>
+UniValue getPageResult(const std::string& strName, const UniValue& items, const Key &nextKey)
+{
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair(strName, items));
+    if (!nextKey.txhash.IsNull()) {
+        CDataStream ssCursor(SER_DISK, CLIENT_VERSION);
+        ssCursor << nextKey;
+        result.push_back(Pair("cursor", HexStr(ssCursor.begin(), ssCursor.end())));
+    }
+    return result;
+}
+
 UniValue getaddressmempool(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -673,8 +732,10 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "      \"address\"  (string) The base58check encoded address\n"
             "      ,...\n"
             "    ]\n"
+            "  \"limit\" (number, optional) Return at most this many outputs of a single address, in index order\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page\n"
             "}\n"
-            "\nResult\n"
+            "\nResult (with a limit, as {\"utxos\": [...], \"cursor\": \"...\"} where cursor is left out on the last page)\n"
             "[\n"
             "  {\n"
             "    \"address\"  (string) The address base58check encoded\n"
@@ -696,15 +757,22 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    size_t nLimit = 0;
+    CAddressUnspentKey nextKey;
+    bool fPaged = getPagingFromParams(params, addresses, nLimit, nextKey);
+
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs, fPaged ? &nextKey : NULL, nLimit)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
     }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    // Pages keep the index order so that they line up with the cursor
+    if (!fPaged) {
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    }
 
     UniValue result(UniValue::VARR);
 
@@ -724,6 +792,10 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         result.push_back(output);
     }
 
+    if (fPaged) {
+        return getPageResult("utxos", result, nextKey);
+    }
+
     return result;
 }
 
@@ -742,8 +814,10 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many changes of a single address\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page, takes the place of start\n"
             "}\n"
-            "\nResult:\n"
+            "\nResult (with a limit, as {\"deltas\": [...], \"cursor\": \"...\"} where cursor is left out on the last page):\n"
             "[\n"
             "  {\n"
             "    \"satoshis\"  (number) The difference of duffs\n"
@@ -780,15 +854,19 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    size_t nLimit = 0;
+    CAddressIndexKey nextKey;
+    bool fPaged = getPagingFromParams(params, addresses, nLimit, nextKey);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end, fPaged ? &nextKey : NULL, nLimit)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, 0, 0, fPaged ? &nextKey : NULL, nLimit)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         }
@@ -812,6 +890,10 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         result.push_back(delta);
     }
 
+    if (fPaged) {
+        return getPageResult("deltas", result, nextKey);
+    }
+
     return result;
 }
 
@@ -845,22 +927,16 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
     CAmount balance = 0;
     CAmount received = 0;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        CAddressBalanceValue value;
+        if (!GetAddressBalance((*it).first, (*it).second, value)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-        balance += it->second;
+        balance += value.balance;
+        received += value.received;
     }
 
     UniValue result(UniValue::VOBJ);
@@ -886,8 +962,11 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Read at most this many index entries of a single address,\n"
+            "            a transaction split over two pages is listed on both\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page, takes the place of start\n"
             "}\n"
-            "\nResult:\n"
+            "\nResult (with a limit, as {\"txids\": [...], \"cursor\": \"...\"} where cursor is left out on the last page):\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
@@ -914,15 +993,19 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
         }
     }
 
+    size_t nLimit = 0;
+    CAddressIndexKey nextKey;
+    bool fPaged = getPagingFromParams(params, addresses, nLimit, nextKey);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end, fPaged ? &nextKey : NULL, nLimit)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, 0, 0, fPaged ? &nextKey : NULL, nLimit)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         }
@@ -950,6 +1033,10 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
         }
     }
 
+    if (fPaged) {
+        return getPageResult("txids", result, nextKey);
+    }
+
     return result;
 
 }
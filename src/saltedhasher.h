@@ -0,0 +1,29 @@
+// Copyright (c) 2009-2010 Satoshi Nakamoto
+// Copyright (c) 2009-2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SALTEDHASHER_H
+#define BITCOIN_SALTEDHASHER_H
+
+#include "hash.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+/** Hasher for unordered containers keyed by txids or other uint256 hashes, salted per instance */
+class SaltedTxidHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedTxidHasher();
+
+    size_t operator()(const uint256& txid) const {
+        return SipHashUint256(k0, k1, txid);
+    }
+};
+
+#endif // BITCOIN_SALTEDHASHER_H
@@ -6,15 +6,125 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include "crypto/sha256.h"
+#include "cuckoocache.h"
+#include "pubkey.h"
+#include "random.h"
 #include "script/interpreter.h"
 
+#include <atomic>
+#include <cstring>
 #include <vector>
 
-// DoS prevention: limit cache size to less than 40MB (over 500000
-// entries on 64-bit systems).
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+// DoS prevention: limit cache size to 40MB (over 1 million entries on
+// 64-bit systems). The cuckoo cache allocates all of it up front.
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 40;
+// Maximum sig cache size allowed
+static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+
+/**
+ * We're hashing a nonce into the entries themselves, so we don't need extra
+ * blinding in the set hash computation.
+ *
+ * This may exhibit platform endian dependent behavior but because these are
+ * nonced hashes (random) and this state is only ever used locally it is safe.
+ * All that matters is local consistency.
+ */
+class SignatureCacheHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select <8, "SignatureCacheHasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin()+4*hash_select, 4);
+        return u;
+    }
+};
 
-class CPubKey;
+/** Lookup counters of the signature cache, see getsigcacheinfo */
+struct CSignatureCacheStats
+{
+    size_t nBytes;
+    size_t nElements;
+    uint64_t nLookups;
+    uint64_t nHits;
+};
+
+/**
+ * Cache of signatures known to be valid, shared by the script and the special
+ * message signature caches. Entries are SHA256(nonce || hash || public key ||
+ * signature) with a random per-cache nonce, so they can't be predicted or
+ * collided by peers. Only inserts take the lock exclusively; lookups and
+ * erases share it, as they only read the table and flip its atomic erase
+ * flags. Inserts move entries between their slots, which a lookup must not
+ * see half done.
+ */
+template <typename Entry, typename Hasher = SignatureCacheHasher>
+class CSaltedSignatureCache
+{
+private:
+    uint256 nonce;
+    CuckooCache::cache<Entry, Hasher> setValid;
+    boost::shared_mutex cs_sigcache;
+    size_t nBytes;
+    size_t nElements;
+    std::atomic<uint64_t> nLookups;
+    std::atomic<uint64_t> nHits;
+
+public:
+    CSaltedSignatureCache() : nBytes(0), nElements(0), nLookups(0), nHits(0)
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(Entry& entry, const uint256& hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey) const
+    {
+        CSHA256 hasher;
+        hasher.Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(pubkey.begin(), pubkey.size());
+        if (!vchSig.empty())
+            hasher.Write(&vchSig[0], vchSig.size());
+        hasher.Finalize(entry.begin());
+    }
+
+    bool Get(const Entry& entry, const bool erase)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        bool fFound = setValid.contains(entry, erase);
+        nLookups.fetch_add(1, std::memory_order_relaxed);
+        if (fFound)
+            nHits.fetch_add(1, std::memory_order_relaxed);
+        return fFound;
+    }
+
+    void Set(const Entry& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        nElements = setValid.setup_bytes(n);
+        nBytes = setValid.DynamicMemoryUsage();
+        return nElements;
+    }
+
+    CSignatureCacheStats GetStats() const
+    {
+        CSignatureCacheStats stats;
+        stats.nBytes = nBytes;
+        stats.nElements = nElements;
+        stats.nLookups = nLookups.load(std::memory_order_relaxed);
+        stats.nHits = nHits.load(std::memory_order_relaxed);
+        return stats;
+    }
+};
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
@@ -27,4 +137,8 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+/** Allocate the signature cache, sized by -maxsigcachesize. Must be called before any lookup. */
+void InitSignatureCache();
+CSignatureCacheStats GetSignatureCacheStats();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
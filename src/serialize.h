@@ -18,6 +18,7 @@
 #include <stdint.h>
 #include <string>
 #include <string.h>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -569,6 +570,13 @@ template<typename K, typename T, typename Pred, typename A> unsigned int GetSeri
 template<typename Stream, typename K, typename T, typename Pred, typename A> void Serialize(Stream& os, const std::map<K, T, Pred, A>& m, int nType, int nVersion);
 template<typename Stream, typename K, typename T, typename Pred, typename A> void Unserialize(Stream& is, std::map<K, T, Pred, A>& m, int nType, int nVersion);
 
+/**
+ * unordered_map, same format as map
+ */
+template<typename K, typename T, typename H, typename Pred, typename A> unsigned int GetSerializeSize(const std::unordered_map<K, T, H, Pred, A>& m, int nType, int nVersion);
+template<typename Stream, typename K, typename T, typename H, typename Pred, typename A> void Serialize(Stream& os, const std::unordered_map<K, T, H, Pred, A>& m, int nType, int nVersion);
+template<typename Stream, typename K, typename T, typename H, typename Pred, typename A> void Unserialize(Stream& is, std::unordered_map<K, T, H, Pred, A>& m, int nType, int nVersion);
+
 /**
  * set
  */
@@ -877,6 +885,41 @@ void Unserialize(Stream& is, std::map<K, T, Pred, A>& m, int nType, int nVersion
 
 
 
+/**
+ * unordered_map
+ */
+template<typename K, typename T, typename H, typename Pred, typename A>
+unsigned int GetSerializeSize(const std::unordered_map<K, T, H, Pred, A>& m, int nType, int nVersion)
+{
+    unsigned int nSize = GetSizeOfCompactSize(m.size());
+    for (typename std::unordered_map<K, T, H, Pred, A>::const_iterator mi = m.begin(); mi != m.end(); ++mi)
+        nSize += GetSerializeSize((*mi), nType, nVersion);
+    return nSize;
+}
+
+template<typename Stream, typename K, typename T, typename H, typename Pred, typename A>
+void Serialize(Stream& os, const std::unordered_map<K, T, H, Pred, A>& m, int nType, int nVersion)
+{
+    WriteCompactSize(os, m.size());
+    for (typename std::unordered_map<K, T, H, Pred, A>::const_iterator mi = m.begin(); mi != m.end(); ++mi)
+        Serialize(os, (*mi), nType, nVersion);
+}
+
+template<typename Stream, typename K, typename T, typename H, typename Pred, typename A>
+void Unserialize(Stream& is, std::unordered_map<K, T, H, Pred, A>& m, int nType, int nVersion)
+{
+    m.clear();
+    unsigned int nSize = ReadCompactSize(is);
+    for (unsigned int i = 0; i < nSize; i++)
+    {
+        std::pair<K, T> item;
+        Unserialize(is, item, nType, nVersion);
+        m.insert(item);
+    }
+}
+
+
+
 /**
  * set
  */
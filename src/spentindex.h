@@ -369,5 +369,45 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+/** Running totals of all address index entries of one address, keyed by CAddressIndexIteratorKey */
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(balance);
+        READWRITE(received);
+    }
+
+    CAddressBalanceValue(CAmount balanceIn, CAmount receivedIn) {
+        balance = balanceIn;
+        received = receivedIn;
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+    }
+
+    bool IsNull() const {
+        return (balance == 0 && received == 0);
+    }
+
+    void Apply(CAmount delta, bool fUndo) {
+        CAmount sign = fUndo ? -1 : 1;
+        balance += sign * delta;
+        // received counts everything ever paid to the address, change included
+        if (delta > 0)
+            received += sign * delta;
+    }
+};
+
 
 #endif // BITCOIN_SPENTINDEX_H
@@ -39,7 +39,6 @@ static const int64_t SPORK_12_RECONSIDER_BLOCKS_DEFAULT                 = 0;
 static const int64_t SPORK_13_OLD_SUPERBLOCK_FLAG_DEFAULT               = 0;	//4070908800ULL;// OFF
 static const int64_t SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT             = 0;	//4070908800ULL;// OFF
 
-extern std::map<uint256, CSporkMessage> mapSporks;
 extern CSporkManager sporkManager;
 
 //
@@ -100,6 +99,9 @@ class CSporkManager
 private:
     std::vector<unsigned char> vchSig;
     std::string strMasterPrivKey;
+    // protects mapSporksByHash and mapSporksActive, spork values are read from every thread
+    CCriticalSection cs;
+    std::map<uint256, CSporkMessage> mapSporksByHash;
     std::map<int, CSporkMessage> mapSporksActive;
 
 public:
@@ -110,6 +112,8 @@ public:
     void ExecuteSpork(int nSporkID, int nValue);
     bool UpdateSpork(int nSporkID, int64_t nValue, CConnman& connman);
 
+    bool GetSporkByHash(const uint256& hash, CSporkMessage& sporkRet);
+
     bool IsSporkActive(int nSporkID);
     int64_t GetSporkValue(int nSporkID);
     int GetSporkIDByName(std::string strName);
@@ -0,0 +1,228 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "spentindex.h"
+#include "txdb.h"
+#include "utilstrencodings.h"
+#include "validation.h"
+
+#include "test/test_veda.h"
+
+#include <boost/test/unit_test.hpp>
+
+struct AddressIndexSetup : public TestingSetup {
+    AddressIndexSetup() {
+        pblocktree->OpenIndexes(true, true, true, true);
+        pblocktree->WriteIndexMarkers();
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, AddressIndexSetup)
+
+static std::pair<CAddressIndexKey, CAmount> AddressEntry(const uint160& hash, int nHeight, int n, bool fSpending, CAmount nValue)
+{
+    return std::make_pair(CAddressIndexKey(1, hash, nHeight, 0, ArithToUint256(arith_uint256(nHeight)), n, fSpending), nValue);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_balance)
+{
+    uint160 hash = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    CAddressBalanceValue value;
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vBlock1;
+    vBlock1.push_back(AddressEntry(hash, 1, 0, false, 50 * COIN));
+    vBlock1.push_back(AddressEntry(hash, 1, 1, false, 20 * COIN));
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vBlock2;
+    vBlock2.push_back(AddressEntry(hash, 2, 0, true, -50 * COIN));
+    vBlock2.push_back(AddressEntry(hash, 2, 1, false, 5 * COIN));
+
+    BOOST_CHECK(pblocktree->WriteAddressIndex(vBlock1));
+    BOOST_CHECK(pblocktree->WriteAddressIndex(vBlock2));
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hash, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 25 * COIN);
+    BOOST_CHECK_EQUAL(value.received, 75 * COIN);
+
+    // writing entries that are already indexed must not count them twice
+    BOOST_CHECK(pblocktree->HaveAddressIndexHeight());
+    BOOST_CHECK(pblocktree->WriteAddressIndex(vBlock2));
+    BOOST_CHECK(pblocktree->WriteAddressIndex(vBlock1));
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hash, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 25 * COIN);
+    BOOST_CHECK_EQUAL(value.received, 75 * COIN);
+
+    // a rebuild from the raw entries gives the same totals
+    BOOST_CHECK(pblocktree->RebuildAddressBalanceIndex());
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hash, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 25 * COIN);
+    BOOST_CHECK_EQUAL(value.received, 75 * COIN);
+
+    // disconnecting blocks undoes their entries, the same address of another type is separate
+    BOOST_CHECK(pblocktree->EraseAddressIndex(vBlock2));
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hash, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 70 * COIN);
+    BOOST_CHECK_EQUAL(value.received, 70 * COIN);
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hash, 2, value));
+    BOOST_CHECK(value.IsNull());
+
+    BOOST_CHECK(pblocktree->EraseAddressIndex(vBlock1));
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hash, 1, value));
+    BOOST_CHECK(value.IsNull());
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_paging)
+{
+    uint160 hash = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    uint160 hashOther = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121315"));
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+    for (int i = 1; i <= 5; i++)
+        vEntries.push_back(AddressEntry(hash, i, 0, false, i * COIN));
+    vEntries.push_back(AddressEntry(hashOther, 1, 0, false, COIN));
+    BOOST_CHECK(pblocktree->WriteAddressIndex(vEntries));
+    CAddressBalanceValue value;
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hash, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 15 * COIN);
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hashOther, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, COIN);
+
+    // pages of two follow each other without gaps and stop at the end of the address
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    CAddressIndexKey nextKey;
+    int nPages = 0;
+    do {
+        size_t nBefore = addressIndex.size();
+        BOOST_CHECK(pblocktree->ReadAddressIndex(hash, 1, addressIndex, 0, 0, &nextKey, 2));
+        BOOST_CHECK(addressIndex.size() - nBefore <= 2);
+        nPages++;
+    } while (!nextKey.txhash.IsNull());
+    BOOST_CHECK_EQUAL(nPages, 3);
+    BOOST_CHECK_EQUAL(addressIndex.size(), 5);
+    for (int i = 0; i < 5; i++)
+        BOOST_CHECK_EQUAL(addressIndex[i].first.blockHeight, i + 1);
+
+    // the height range still applies to pages
+    addressIndex.clear();
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hash, 1, addressIndex, 2, 3, &nextKey, 1));
+    BOOST_CHECK_EQUAL(addressIndex.size(), 1);
+    BOOST_CHECK(!nextKey.txhash.IsNull());
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hash, 1, addressIndex, 2, 3, &nextKey, 1));
+    BOOST_CHECK_EQUAL(addressIndex.size(), 2);
+    BOOST_CHECK_EQUAL(addressIndex[1].first.blockHeight, 3);
+    BOOST_CHECK(nextKey.txhash.IsNull());
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vUnspent;
+    for (int i = 1; i <= 3; i++) {
+        CAddressUnspentKey key(1, hash, ArithToUint256(arith_uint256(i)), 0);
+        vUnspent.push_back(std::make_pair(key, CAddressUnspentValue(i * COIN, CScript(), i)));
+    }
+    BOOST_CHECK(pblocktree->UpdateAddressUnspentIndex(vUnspent));
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    CAddressUnspentKey nextUnspentKey;
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(hash, 1, unspentOutputs, &nextUnspentKey, 2));
+    BOOST_CHECK_EQUAL(unspentOutputs.size(), 2);
+    BOOST_CHECK(!nextUnspentKey.txhash.IsNull());
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(hash, 1, unspentOutputs, &nextUnspentKey, 2));
+    BOOST_CHECK_EQUAL(unspentOutputs.size(), 3);
+    BOOST_CHECK(nextUnspentKey.txhash.IsNull());
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_move)
+{
+    uint160 hash = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+
+    // entries as older versions wrote them into the block database
+    std::pair<CAddressIndexKey, CAmount> entry = AddressEntry(hash, 1, 0, false, COIN);
+    BOOST_CHECK(pblocktree->Write(std::make_pair('a', entry.first), entry.second));
+    BOOST_CHECK(pblocktree->Write(std::make_pair('A', CAddressIndexIteratorKey(1, hash)), CAddressBalanceValue(COIN, COIN)));
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hash, 1, addressIndex));
+    BOOST_CHECK(addressIndex.empty());
+
+    BOOST_CHECK(pblocktree->MoveIndexes());
+    BOOST_CHECK(!pblocktree->Exists(std::make_pair('a', entry.first)));
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hash, 1, addressIndex));
+    BOOST_CHECK_EQUAL(addressIndex.size(), 1);
+    CAddressBalanceValue value;
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hash, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, COIN);
+
+    // moving again finds nothing left to move
+    BOOST_CHECK(pblocktree->MoveIndexes());
+    BOOST_CHECK(pblocktree->SyncIndexes());
+
+    // the moved entries come without their highest height, the rebuild records it so that
+    // connecting their block again after a crash still doesn't count them twice
+    BOOST_CHECK(!pblocktree->HaveAddressIndexHeight());
+    BOOST_CHECK(pblocktree->RebuildAddressBalanceIndex());
+    BOOST_CHECK(pblocktree->HaveAddressIndexHeight());
+    BOOST_CHECK(pblocktree->WriteAddressIndex(std::vector<std::pair<CAddressIndexKey, CAmount> >(1, entry)));
+    BOOST_CHECK(pblocktree->ReadAddressBalance(hash, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, COIN);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_disabled)
+{
+    uint160 hash = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vBlock;
+    vBlock.push_back(AddressEntry(hash, 1, 0, false, COIN));
+
+    // entries of a disabled index stay in the block database, nothing is opened for them
+    pblocktree->OpenIndexes(true, false, false, false);
+    BOOST_CHECK(pblocktree->Write(std::make_pair('a', vBlock[0].first), vBlock[0].second));
+    BOOST_CHECK(pblocktree->MoveIndexes());
+    BOOST_CHECK(pblocktree->Exists(std::make_pair('a', vBlock[0].first)));
+    BOOST_CHECK(!pblocktree->WriteAddressIndex(vBlock));
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    BOOST_CHECK(!pblocktree->ReadAddressIndex(hash, 1, addressIndex));
+    BOOST_CHECK(pblocktree->SyncIndexes());
+
+    pblocktree->OpenIndexes(true, true, true, true);
+    BOOST_CHECK(pblocktree->MoveIndexes());
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hash, 1, addressIndex));
+    BOOST_CHECK_EQUAL(addressIndex.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_markers)
+{
+    std::vector<std::string> vMissing;
+    BOOST_CHECK(pblocktree->CheckIndexMarkers(vMissing));
+    BOOST_CHECK(vMissing.empty());
+
+    // an index database replaced by an empty one is noticed
+    pblocktree->OpenIndexes(true, false, true, true);
+    pblocktree->OpenIndexes(true, true, true, true);
+    BOOST_CHECK(pblocktree->CheckIndexMarkers(vMissing));
+    BOOST_CHECK_EQUAL(vMissing.size(), 1);
+    BOOST_CHECK_EQUAL(vMissing[0], "addressindex");
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_wipe)
+{
+    uint160 hash = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vBlock;
+    vBlock.push_back(AddressEntry(hash, 1, 0, false, COIN));
+    std::vector<std::pair<uint256, CDiskTxPos> > vPos;
+    vPos.push_back(std::make_pair(ArithToUint256(arith_uint256(1)), CDiskTxPos(CDiskBlockPos(0, 8), 1)));
+    BOOST_CHECK(pblocktree->WriteAddressIndex(vBlock));
+    BOOST_CHECK(pblocktree->WriteTxIndex(vPos));
+
+    // only the named database is emptied for its rebuild, and loses its marker
+    std::vector<std::string> vWipe(1, "addressindex");
+    pblocktree->OpenIndexes(true, true, true, true, vWipe);
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hash, 1, addressIndex));
+    BOOST_CHECK(addressIndex.empty());
+    BOOST_CHECK(!pblocktree->HaveAddressIndexHeight());
+    CDiskTxPos pos;
+    BOOST_CHECK(pblocktree->ReadTxIndex(vPos[0].first, pos));
+    std::vector<std::string> vMissing;
+    BOOST_CHECK(pblocktree->CheckIndexMarkers(vMissing));
+    BOOST_CHECK_EQUAL(vMissing.size(), 1);
+    BOOST_CHECK_EQUAL(vMissing[0], "addressindex");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
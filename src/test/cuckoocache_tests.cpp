@@ -0,0 +1,163 @@
+// Copyright (c) 2012-2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cuckoocache.h"
+#include "script/sigcache.h"
+#include "random.h"
+#include "uint256.h"
+
+#include "test/test_veda.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+/** Test Suite for CuckooCache
+ *
+ *  1) All tests should have a deterministic result (using insecure rand
+ *  with deterministic seeds)
+ *  2) Some test methods are templated to allow for easier testing
+ *  against new versions / comparing
+ *  3) Results should be treated as a regression test, i.e., did the behavior
+ *  change significantly from what was expected. This can be OK, depending on
+ *  the nature of the change, but requires updating the tests to reflect the new
+ *  expected behavior. For example improving the hit rate may cause some tests
+ *  using BOOST_CHECK_CLOSE to fail.
+ *
+ */
+BOOST_FIXTURE_TEST_SUITE(cuckoocache_tests, BasicTestingSetup)
+
+static void insecure_GetRandHash(uint256& t)
+{
+    uint32_t* ptr = (uint32_t*)t.begin();
+    for (uint8_t j = 0; j < 8; ++j)
+        *(ptr++) = insecure_rand();
+}
+
+/** Check that the cache never claims to hold an element it was never given */
+BOOST_AUTO_TEST_CASE(test_cuckoocache_no_fakes)
+{
+    seed_insecure_rand(true);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc;
+    size_t megabytes = 4;
+    cc.setup_bytes(megabytes << 20);
+    uint256 v;
+    for (int x = 0; x < 100000; ++x) {
+        insecure_GetRandHash(v);
+        cc.insert(v);
+    }
+    for (int x = 0; x < 100000; ++x) {
+        insecure_GetRandHash(v);
+        BOOST_CHECK(!cc.contains(v, false));
+    }
+}
+
+/** Fill a cache to load * capacity and return the fraction of those elements still found */
+static double test_cache(size_t megabytes, double load)
+{
+    seed_insecure_rand(true);
+    std::vector<uint256> hashes;
+    CuckooCache::cache<uint256, SignatureCacheHasher> set;
+    size_t bytes = megabytes * (1 << 20);
+    set.setup_bytes(bytes);
+    uint32_t n_insert = static_cast<uint32_t>(load * (bytes / sizeof(uint256)));
+    hashes.resize(n_insert);
+    for (uint32_t i = 0; i < n_insert; ++i)
+        insecure_GetRandHash(hashes[i]);
+    for (uint32_t i = 0; i < n_insert; ++i)
+        set.insert(hashes[i]);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < n_insert; ++i)
+        count += set.contains(hashes[i], false);
+    return double(count) / double(n_insert);
+}
+
+/** The hit rate only falls off once the load approaches the table size */
+BOOST_AUTO_TEST_CASE(cuckoocache_hit_rate_ok)
+{
+    /** Arbitrarily selected Hit Rate threshold that happens to work for this test
+     * as a lower bound on performance.
+     */
+    double HitRateThresh = 0.98;
+    size_t megabytes = 4;
+    for (double load = 0.1; load < 2; load *= 2) {
+        double hits = test_cache(megabytes, load);
+        // Past full load at most 1 / load of the elements can fit
+        BOOST_CHECK(hits >= std::min(HitRateThresh, 0.95 / load));
+    }
+}
+
+/** Elements looked up with erase set are the first to be overwritten */
+BOOST_AUTO_TEST_CASE(cuckoocache_erase_ok)
+{
+    seed_insecure_rand(true);
+    CuckooCache::cache<uint256, SignatureCacheHasher> set;
+    size_t megabytes = 4;
+    size_t bytes = megabytes * (1 << 20);
+    uint32_t n_insert = set.setup_bytes(bytes) * 0.9;
+
+    std::vector<uint256> hashes(n_insert);
+    for (uint32_t i = 0; i < n_insert; ++i)
+        insecure_GetRandHash(hashes[i]);
+
+    // Insert the first half, then erase all of it
+    for (uint32_t i = 0; i < n_insert / 2; ++i)
+        set.insert(hashes[i]);
+    for (uint32_t i = 0; i < n_insert / 2; ++i)
+        BOOST_CHECK(set.contains(hashes[i], true));
+
+    // Erased elements stay readable until their slot is needed
+    for (uint32_t i = 0; i < n_insert / 2; ++i)
+        BOOST_CHECK(set.contains(hashes[i], false));
+
+    // The second half goes into the slots the first half released
+    for (uint32_t i = n_insert / 2; i < n_insert; ++i)
+        set.insert(hashes[i]);
+
+    uint32_t count_erased = 0, count_kept = 0;
+    for (uint32_t i = 0; i < n_insert / 2; ++i)
+        count_erased += set.contains(hashes[i], false);
+    for (uint32_t i = n_insert / 2; i < n_insert; ++i)
+        count_kept += set.contains(hashes[i], false);
+
+    BOOST_CHECK_EQUAL(count_kept, n_insert - n_insert / 2);
+    BOOST_CHECK(count_erased < n_insert / 2);
+}
+
+/** Once an epoch fills up, elements from two generations ago are evicted
+ * before anything in the live or the previous generation */
+BOOST_AUTO_TEST_CASE(cuckoocache_generations)
+{
+    seed_insecure_rand(true);
+    CuckooCache::cache<uint256, SignatureCacheHasher> set;
+    size_t megabytes = 4;
+    size_t bytes = megabytes * (1 << 20);
+    uint32_t n_insert = set.setup_bytes(bytes);
+
+    // Insert 1.6 tables worth of elements in three generations, keeping the
+    // last generation around as the live one.
+    const uint32_t nGeneration = n_insert * 0.53;
+    std::vector<std::vector<uint256> > generations(3, std::vector<uint256>(nGeneration));
+    for (size_t g = 0; g < generations.size(); ++g) {
+        for (uint32_t i = 0; i < nGeneration; ++i) {
+            insecure_GetRandHash(generations[g][i]);
+            set.insert(generations[g][i]);
+        }
+    }
+
+    std::vector<double> hit_rate(generations.size());
+    for (size_t g = 0; g < generations.size(); ++g) {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < nGeneration; ++i)
+            count += set.contains(generations[g][i], false);
+        hit_rate[g] = double(count) / nGeneration;
+    }
+
+    // The newest generation survives almost entirely, the oldest is mostly gone
+    BOOST_CHECK(hit_rate[2] > 0.98);
+    BOOST_CHECK(hit_rate[1] > hit_rate[0]);
+    BOOST_CHECK(hit_rate[0] < 0.5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
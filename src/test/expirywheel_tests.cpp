@@ -0,0 +1,56 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "expirywheel.h"
+
+#include "test/test_veda.h"
+
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(expirywheel_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(expirywheel_test)
+{
+    CExpiryWheel<int> wheel(10);
+
+    wheel.Add(1, 105);
+    wheel.Add(2, 112);
+    wheel.Add(3, 100);
+    wheel.Add(4, 250);
+    BOOST_CHECK_EQUAL(wheel.GetSize(), 4);
+
+    // nothing is due yet
+    std::vector<int> vecKeys;
+    wheel.PopExpired(99, vecKeys);
+    BOOST_CHECK(vecKeys.empty());
+    BOOST_CHECK_EQUAL(wheel.GetSize(), 4);
+
+    // the whole bucket of a due key comes out, even keys that expire later in that bucket
+    wheel.PopExpired(101, vecKeys);
+    BOOST_CHECK_EQUAL(vecKeys.size(), 2);
+    BOOST_CHECK(std::find(vecKeys.begin(), vecKeys.end(), 1) != vecKeys.end());
+    BOOST_CHECK(std::find(vecKeys.begin(), vecKeys.end(), 3) != vecKeys.end());
+    BOOST_CHECK_EQUAL(wheel.GetSize(), 2);
+
+    // keys handed back go into the bucket of their new expiry time
+    wheel.Add(1, 105);
+    vecKeys.clear();
+    wheel.PopExpired(120, vecKeys);
+    BOOST_CHECK_EQUAL(vecKeys.size(), 2);
+    BOOST_CHECK_EQUAL(wheel.GetSize(), 1);
+
+    // later buckets stay untouched
+    vecKeys.clear();
+    wheel.PopExpired(249, vecKeys);
+    BOOST_CHECK(vecKeys.empty());
+
+    wheel.Clear();
+    BOOST_CHECK_EQUAL(wheel.GetSize(), 0);
+    wheel.PopExpired(1000, vecKeys);
+    BOOST_CHECK(vecKeys.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,159 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "clientversion.h"
+#include "governance.h"
+#include "governance-object.h"
+#include "governance-vote.h"
+#include "masternode.h"
+#include "masternodeman.h"
+#include "net.h"
+#include "random.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include "test/test_veda.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_votecount_tests, TestingSetup)
+
+namespace {
+
+/** A masternode in mnodeman that can sign governance votes */
+struct CVotingMasternode
+{
+    CKey key;
+    CPubKey pubkey;
+    COutPoint outpoint;
+
+    CVotingMasternode() : outpoint(GetRandHash(), 0)
+    {
+        key.MakeNewKey(true);
+        pubkey = key.GetPubKey();
+    }
+
+    void Add()
+    {
+        CMasternode mn(CService(), outpoint, pubkey, pubkey, PROTOCOL_VERSION);
+        mnodeman.Add(mn);
+    }
+
+    CGovernanceVote Vote(const uint256& nParentHash, vote_signal_enum_t eSignal, vote_outcome_enum_t eOutcome)
+    {
+        CGovernanceVote vote(outpoint, nParentHash, eSignal, eOutcome);
+        BOOST_CHECK(vote.Sign(key, pubkey));
+        return vote;
+    }
+};
+
+}
+
+/** Put govobj into the governance manager the way governance.dat is loaded */
+static void LoadGovernanceObject(const CGovernanceObject& govobj)
+{
+    std::string strVersion;
+    CGovernanceManager::hash_time_m_t mapErasedGovernanceObjects, mapWatchdogObjects;
+    CGovernanceManager::vote_cache_t mapInvalidVotes;
+    CGovernanceManager::vote_mcache_t mapOrphanVotes;
+    CGovernanceManager::object_m_t mapObjects;
+    uint256 nHashWatchdogCurrent;
+    int64_t nTimeWatchdogCurrent;
+    CGovernanceManager::txout_m_t mapLastMasternodeObject;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CGovernanceManager();
+    ss >> strVersion >> mapErasedGovernanceObjects >> mapInvalidVotes >> mapOrphanVotes >> mapObjects
+       >> mapWatchdogObjects >> nHashWatchdogCurrent >> nTimeWatchdogCurrent >> mapLastMasternodeObject;
+    mapObjects.insert(std::make_pair(govobj.GetHash(), govobj));
+    ss << strVersion << mapErasedGovernanceObjects << mapInvalidVotes << mapOrphanVotes << mapObjects
+       << mapWatchdogObjects << nHashWatchdogCurrent << nTimeWatchdogCurrent << mapLastMasternodeObject;
+    ss >> governance;
+}
+
+/** The counts kept up to date vote by vote must equal the ones rebuilt from the current votes */
+static void CheckVoteCounts(const uint256& nHash)
+{
+    CGovernanceObject* pgovobj = governance.FindGovernanceObject(nHash);
+    BOOST_REQUIRE(pgovobj);
+
+    // reading an object from disk rebuilds its counts with RebuildVoteCounts()
+    CGovernanceObject govobjRebuilt;
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << *pgovobj;
+    ss >> govobjRebuilt;
+
+    const vote_signal_enum_t signals[] = {VOTE_SIGNAL_FUNDING, VOTE_SIGNAL_VALID, VOTE_SIGNAL_DELETE};
+    BOOST_FOREACH(vote_signal_enum_t eSignal, signals) {
+        BOOST_CHECK_EQUAL(pgovobj->GetAbsoluteYesCount(eSignal), govobjRebuilt.GetAbsoluteYesCount(eSignal));
+        BOOST_CHECK_EQUAL(pgovobj->GetAbsoluteNoCount(eSignal), govobjRebuilt.GetAbsoluteNoCount(eSignal));
+        BOOST_CHECK_EQUAL(pgovobj->GetYesCount(eSignal), govobjRebuilt.GetYesCount(eSignal));
+        BOOST_CHECK_EQUAL(pgovobj->GetNoCount(eSignal), govobjRebuilt.GetNoCount(eSignal));
+        BOOST_CHECK_EQUAL(pgovobj->GetAbstainCount(eSignal), govobjRebuilt.GetAbstainCount(eSignal));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(governance_votecount_rebuild)
+{
+    int64_t nTime = GetTime();
+    SetMockTime(nTime);
+
+    std::vector<CVotingMasternode> vMasternodes(12);
+    mnodeman.Clear();
+    for (size_t i = 0; i < vMasternodes.size(); i++)
+        vMasternodes[i].Add();
+
+    std::string strData = HexStr(std::string("[[\"proposal\",{\"type\":1,\"name\":\"votecount\"}]]"));
+    CGovernanceObject govobj(uint256(), 1, nTime, GetRandHash(), strData);
+    uint256 nHash = govobj.GetHash();
+    LoadGovernanceObject(govobj);
+    BOOST_REQUIRE(governance.FindGovernanceObject(nHash));
+
+    CGovernanceException exception;
+
+    // yes, yes, no, abstain on funding, and every other masternode says the proposal is valid
+    for (size_t i = 0; i < vMasternodes.size(); i++) {
+        vote_outcome_enum_t eOutcome = i % 4 < 2 ? VOTE_OUTCOME_YES : i % 4 == 2 ? VOTE_OUTCOME_NO : VOTE_OUTCOME_ABSTAIN;
+        BOOST_CHECK(governance.ProcessVoteAndRelay(vMasternodes[i].Vote(nHash, VOTE_SIGNAL_FUNDING, eOutcome), exception, *g_connman));
+        if (i % 2 == 0)
+            BOOST_CHECK(governance.ProcessVoteAndRelay(vMasternodes[i].Vote(nHash, VOTE_SIGNAL_VALID, VOTE_OUTCOME_YES), exception, *g_connman));
+    }
+    CheckVoteCounts(nHash);
+    CGovernanceObject* pgovobj = governance.FindGovernanceObject(nHash);
+    BOOST_CHECK_EQUAL(pgovobj->GetYesCount(VOTE_SIGNAL_FUNDING), 6);
+    BOOST_CHECK_EQUAL(pgovobj->GetNoCount(VOTE_SIGNAL_FUNDING), 3);
+    BOOST_CHECK_EQUAL(pgovobj->GetAbstainCount(VOTE_SIGNAL_FUNDING), 3);
+    BOOST_CHECK_EQUAL(pgovobj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING), 3);
+    BOOST_CHECK_EQUAL(pgovobj->GetYesCount(VOTE_SIGNAL_VALID), 6);
+
+    // the first four masternodes change their funding vote to no, later than they first voted
+    SetMockTime(nTime + GOVERNANCE_UPDATE_MIN + 1);
+    for (size_t i = 0; i < 4; i++)
+        BOOST_CHECK(governance.ProcessVoteAndRelay(vMasternodes[i].Vote(nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO), exception, *g_connman));
+    CheckVoteCounts(nHash);
+    BOOST_CHECK_EQUAL(pgovobj->GetYesCount(VOTE_SIGNAL_FUNDING), 4);
+    BOOST_CHECK_EQUAL(pgovobj->GetNoCount(VOTE_SIGNAL_FUNDING), 6);
+    BOOST_CHECK_EQUAL(pgovobj->GetAbstainCount(VOTE_SIGNAL_FUNDING), 2);
+
+    // masternodes 4 to 7 leave the list, their votes go with them
+    mnodeman.Clear();
+    for (size_t i = 0; i < vMasternodes.size(); i++)
+        if (i < 4 || i >= 8)
+            vMasternodes[i].Add();
+    mnodeman.AddDirtyGovernanceObjectHash(nHash);
+    governance.UpdateCachesAndClean();
+    pgovobj = governance.FindGovernanceObject(nHash);
+    BOOST_REQUIRE(pgovobj);
+    CheckVoteCounts(nHash);
+    BOOST_CHECK_EQUAL(pgovobj->GetYesCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(pgovobj->GetNoCount(VOTE_SIGNAL_FUNDING), 5);
+    BOOST_CHECK_EQUAL(pgovobj->GetAbstainCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(pgovobj->GetYesCount(VOTE_SIGNAL_VALID), 4);
+
+    governance.Clear();
+    mnodeman.Clear();
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,56 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-votedb.h"
+#include "clientversion.h"
+#include "random.h"
+#include "streams.h"
+
+#include "test/test_veda.h"
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_votedb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(votes_by_masternode)
+{
+    CGovernanceObjectVoteFile fileVotes;
+
+    COutPoint outpointMN1(GetRandHash(), 0);
+    COutPoint outpointMN2(GetRandHash(), 1);
+    uint256 nParentHash = GetRandHash();
+
+    fileVotes.AddVote(CGovernanceVote(outpointMN1, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES));
+    fileVotes.AddVote(CGovernanceVote(outpointMN1, nParentHash, VOTE_SIGNAL_DELETE, VOTE_OUTCOME_NO));
+    fileVotes.AddVote(CGovernanceVote(outpointMN2, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO));
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 3);
+
+    std::vector<CGovernanceVote> vecVotes = fileVotes.GetVotesByMasternode(outpointMN1);
+    BOOST_CHECK_EQUAL(vecVotes.size(), 2U);
+    BOOST_FOREACH(const CGovernanceVote& vote, vecVotes) {
+        BOOST_CHECK(vote.GetMasternodeOutpoint() == outpointMN1);
+        BOOST_CHECK(fileVotes.HasVote(vote.GetHash()));
+    }
+
+    // the index survives copies and serialization round trips
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << fileVotes;
+    CGovernanceObjectVoteFile fileVotesRead;
+    ss >> fileVotesRead;
+    BOOST_CHECK_EQUAL(fileVotesRead.GetVotesByMasternode(outpointMN2).size(), 1U);
+    CGovernanceObjectVoteFile fileVotesCopy(fileVotes);
+    BOOST_CHECK_EQUAL(fileVotesCopy.GetVotesByMasternode(outpointMN1).size(), 2U);
+
+    fileVotes.RemoveVotesFromMasternode(outpointMN1);
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 1);
+    BOOST_CHECK(fileVotes.GetVotesByMasternode(outpointMN1).empty());
+    BOOST_FOREACH(const CGovernanceVote& vote, vecVotes) {
+        BOOST_CHECK(!fileVotes.HasVote(vote.GetHash()));
+    }
+    BOOST_CHECK_EQUAL(fileVotes.GetVotesByMasternode(outpointMN2).size(), 1U);
+    BOOST_CHECK_EQUAL(fileVotes.GetVotes().size(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
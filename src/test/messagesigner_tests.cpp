@@ -0,0 +1,94 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messagesigner.h"
+#include "key.h"
+#include "random.h"
+#include "uint256.h"
+#include "test/test_veda.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(messagesigner_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(messagesigner_cache_hit_miss)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+    uint256 hash = GetRandHash();
+    std::vector<unsigned char> vchSig;
+    std::string strError;
+    BOOST_CHECK(CHashSigner::SignHash(hash, key, vchSig));
+
+    // First check is a miss, the second one is served from the cache
+    CSignatureCacheStats before = GetMessageSignatureCacheStats();
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, pubkey, vchSig, strError));
+    CSignatureCacheStats after = GetMessageSignatureCacheStats();
+    BOOST_CHECK_EQUAL(after.nLookups - before.nLookups, 1U);
+    BOOST_CHECK_EQUAL(after.nHits - before.nHits, 0U);
+
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, pubkey, vchSig, strError));
+    before = after;
+    after = GetMessageSignatureCacheStats();
+    BOOST_CHECK_EQUAL(after.nLookups - before.nLookups, 1U);
+    BOOST_CHECK_EQUAL(after.nHits - before.nHits, 1U);
+
+    // A signature for another hash must be neither accepted nor cached
+    uint256 hashOther = GetRandHash();
+    for (int i = 0; i < 2; i++) {
+        before = after;
+        BOOST_CHECK(!CHashSigner::VerifyHash(hashOther, pubkey, vchSig, strError));
+        after = GetMessageSignatureCacheStats();
+        BOOST_CHECK_EQUAL(after.nLookups - before.nLookups, 1U);
+        BOOST_CHECK_EQUAL(after.nHits - before.nHits, 0U);
+    }
+
+    // Neither is the valid signature checked against another key
+    CKey keyOther;
+    keyOther.MakeNewKey(true);
+    before = after;
+    BOOST_CHECK(!CHashSigner::VerifyHash(hash, keyOther.GetPubKey(), vchSig, strError));
+    after = GetMessageSignatureCacheStats();
+    BOOST_CHECK_EQUAL(after.nHits - before.nHits, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(messagesigner_cache_salt)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+    uint256 hash = GetRandHash();
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(CHashSigner::SignHash(hash, key, vchSig));
+
+    CSaltedSignatureCache<uint256> cache1, cache2;
+    cache1.setup_bytes(1 << 16);
+    cache2.setup_bytes(1 << 16);
+
+    uint256 entry1, entry1Again, entry2;
+    cache1.ComputeEntry(entry1, hash, vchSig, pubkey);
+    cache1.ComputeEntry(entry1Again, hash, vchSig, pubkey);
+    cache2.ComputeEntry(entry2, hash, vchSig, pubkey);
+    // Entries are stable within a cache but salted differently across caches
+    BOOST_CHECK(entry1 == entry1Again);
+    BOOST_CHECK(entry1 != entry2);
+
+    cache1.Set(entry1);
+    BOOST_CHECK(cache1.Get(entry1, false));
+    BOOST_CHECK(!cache2.Get(entry1, false));
+    BOOST_CHECK(!cache2.Get(entry2, false));
+
+    CSignatureCacheStats stats = cache1.GetStats();
+    // the table and its flags, not the size asked for
+    BOOST_CHECK(stats.nBytes >= stats.nElements * sizeof(uint256) + stats.nElements / 4);
+    BOOST_CHECK_EQUAL(stats.nLookups, 1U);
+    BOOST_CHECK_EQUAL(stats.nHits, 1U);
+    BOOST_CHECK_EQUAL(cache2.GetStats().nLookups, 2U);
+    BOOST_CHECK_EQUAL(cache2.GetStats().nHits, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,61 @@
+// Copyright (c) 2014-2017 The Veda Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "net.h"
+#include "net_processing.h"
+#include "protocol.h"
+#include "streams.h"
+#include "utiltime.h"
+
+#include "test/test_veda.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(specialmessage_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(specialmessage_routing)
+{
+    CAddress addr(CService(CNetAddr(), Params().GetDefaultPort()), NODE_NONE);
+    CNode dummyNode(1000, NODE_NETWORK, 0, INVALID_SOCKET, addr, "", true);
+    dummyNode.SetSendVersion(PROTOCOL_VERSION);
+    GetNodeSignals().InitializeNode(&dummyNode, *connman);
+    dummyNode.nVersion = 1;
+    dummyNode.fSuccessfullyConnected = true;
+    int nRefCount = dummyNode.GetRefCount();
+
+    InitSpecialMessageWorkers(1);
+    boost::thread worker(boost::bind(&ThreadSpecialMessageWorker, 0));
+
+    // messages the workers don't take are processed right away, on this thread
+    std::string strCommand = NetMsgType::SYNCSTATUSCOUNT;
+    CDataStream vRecv(SER_NETWORK, PROTOCOL_VERSION);
+    vRecv << 0 << 0;
+    BOOST_CHECK(!ProcessOrQueueSpecialMessage(&dummyNode, strCommand, vRecv, *connman));
+    BOOST_CHECK(vRecv.empty());
+    BOOST_CHECK_EQUAL(dummyNode.nSpecialMessagesQueued, 0);
+
+    // governance votes go to the worker, which processes them and lets go of the peer
+    strCommand = NetMsgType::MNGOVERNANCEOBJECTVOTE;
+    CDataStream vRecvVote(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(ProcessOrQueueSpecialMessage(&dummyNode, strCommand, vRecvVote, *connman));
+    for (int i = 0; i < 500 && dummyNode.nSpecialMessagesQueued > 0; i++)
+        MilliSleep(10);
+    BOOST_CHECK_EQUAL(dummyNode.nSpecialMessagesQueued, 0);
+    BOOST_CHECK_EQUAL(dummyNode.GetRefCount(), nRefCount);
+
+    worker.interrupt();
+    worker.join();
+    ClearSpecialMessageWorkers();
+
+    // without workers everything stays on the message handler thread
+    strCommand = NetMsgType::TXLOCKVOTE;
+    BOOST_CHECK(!ProcessOrQueueSpecialMessage(&dummyNode, strCommand, vRecvVote, *connman));
+
+    bool fUpdateConnectionTime = false;
+    GetNodeSignals().FinalizeNode(dummyNode.GetId(), fUpdateConnectionTime);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,7 @@
 #include "ui_interface.h"
 #include "init.h"
 
+#include <algorithm>
 #include <stdint.h>
 
 #include <boost/thread.hpp>
@@ -24,6 +25,7 @@ static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSBALANCEINDEX = 'A';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
@@ -33,6 +35,11 @@ static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
+// in each index database, written once it belongs to the block database
+static const char DB_INDEX_MARKER = 'M';
+// in the address index database, the highest block height it holds entries of
+static const char DB_ADDRESSINDEX_HEIGHT = 'h';
+
 namespace {
 
 struct CoinEntry {
@@ -106,7 +113,39 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+static boost::filesystem::path GetIndexDBPath(const std::string &name, bool fMemory) {
+    if (!fMemory)
+        TryCreateDirectory(GetDataDir() / "indexes");
+    return GetDataDir() / "indexes" / name;
+}
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemoryIn, bool fWipe, size_t nIndexCacheSizeIn) :
+    CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemoryIn, fWipe),
+    fMemory(fMemoryIn), fWipeIndexes(fWipe), nIndexCacheSize(nIndexCacheSizeIn),
+    fTxIndexDirty(false), fAddressIndexDirty(false), fSpentIndexDirty(false), fTimestampIndexDirty(false),
+    nAddressIndexHeight(-2) {
+}
+
+void CBlockTreeDB::OpenIndexDB(boost::scoped_ptr<CDBWrapper> &pdb, const std::string &name, bool fEnabled, size_t nCacheSize, const std::vector<std::string> &vWipe) {
+    bool fWipe = std::find(vWipe.begin(), vWipe.end(), name) != vWipe.end();
+    if (!fEnabled || fWipe)
+        pdb.reset();
+    if (fEnabled && !pdb)
+        pdb.reset(new CDBWrapper(GetIndexDBPath(name, fMemory), nCacheSize, fMemory, fWipeIndexes || fWipe));
+}
+
+void CBlockTreeDB::OpenIndexes(bool fTxIndexIn, bool fAddressIndexIn, bool fSpentIndexIn, bool fTimestampIndexIn, const std::vector<std::string> &vWipe) {
+    // the address index is by far the largest and busiest, the spent and timestamp indexes the smallest
+    size_t nWeights = (fTxIndexIn ? 2 : 0) + (fAddressIndexIn ? 4 : 0) + (fSpentIndexIn ? 1 : 0) + (fTimestampIndexIn ? 1 : 0);
+    size_t nShare = nWeights ? std::max(nIndexCacheSize / nWeights, (size_t)1 << 18) : 0;
+    OpenIndexDB(ptxindexdb, "txindex", fTxIndexIn, 2 * nShare, vWipe);
+    OpenIndexDB(paddressindexdb, "addressindex", fAddressIndexIn, 4 * nShare, vWipe);
+    OpenIndexDB(pspentindexdb, "spentindex", fSpentIndexIn, nShare, vWipe);
+    OpenIndexDB(ptimestampindexdb, "timestampindex", fTimestampIndexIn, nShare, vWipe);
+
+    nAddressIndexHeight = -2;
+    if (paddressindexdb)
+        paddressindexdb->Read(DB_ADDRESSINDEX_HEIGHT, nAddressIndexHeight);
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -195,23 +234,138 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
+static bool SyncIndexDB(const boost::scoped_ptr<CDBWrapper> &pdb, std::atomic<bool> &fDirty) {
+    if (!fDirty.exchange(false) || !pdb)
+        return true;
+    if (!pdb->Sync()) {
+        fDirty = true;
+        return false;
+    }
+    return true;
+}
+
+bool CBlockTreeDB::SyncIndexes() {
+    return SyncIndexDB(ptxindexdb, fTxIndexDirty) &&
+           SyncIndexDB(paddressindexdb, fAddressIndexDirty) &&
+           SyncIndexDB(pspentindexdb, fSpentIndexDirty) &&
+           SyncIndexDB(ptimestampindexdb, fTimestampIndexDirty);
+}
+
+static bool WriteIndexMarker(const boost::scoped_ptr<CDBWrapper> &pdb) {
+    return !pdb || pdb->Write(DB_INDEX_MARKER, '1', true);
+}
+
+static bool HasIndexMarker(const boost::scoped_ptr<CDBWrapper> &pdb) {
+    return !pdb || pdb->Exists(DB_INDEX_MARKER);
+}
+
+bool CBlockTreeDB::WriteIndexMarkers() {
+    if (!WriteIndexMarker(ptxindexdb) || !WriteIndexMarker(paddressindexdb) ||
+        !WriteIndexMarker(pspentindexdb) || !WriteIndexMarker(ptimestampindexdb))
+        return false;
+    return WriteFlag("indexmarkers", true);
+}
+
+bool CBlockTreeDB::CheckIndexMarkers(std::vector<std::string> &vMissing) {
+    bool fIndexMarkers = false;
+    ReadFlag("indexmarkers", fIndexMarkers);
+    // databases from before the markers, fresh ones and ones just moved out of the block database
+    if (!fIndexMarkers)
+        return WriteIndexMarkers();
+    if (!HasIndexMarker(ptxindexdb))
+        vMissing.push_back("txindex");
+    if (!HasIndexMarker(paddressindexdb))
+        vMissing.push_back("addressindex");
+    if (!HasIndexMarker(pspentindexdb))
+        vMissing.push_back("spentindex");
+    if (!HasIndexMarker(ptimestampindexdb))
+        vMissing.push_back("timestampindex");
+    return true;
+}
+
+/** Move all entries with the given prefix from the block database to an index database, if that is open */
+template <typename K, typename V>
+static bool MoveIndexEntries(CDBWrapper &from, const boost::scoped_ptr<CDBWrapper> &pto, char prefix) {
+    if (!pto)
+        return true;
+    CDBWrapper &to = *pto;
+    boost::scoped_ptr<CDBIterator> pcursor(from.NewIterator());
+    CDBBatch batchFrom(from);
+    CDBBatch batchTo(to);
+    size_t batch_size = 1 << 24;
+    size_t count = 0;
+
+    pcursor->Seek(prefix);
+
+    while (true) {
+        boost::this_thread::interruption_point();
+        std::pair<char, K> key;
+        bool fValid = pcursor->Valid() && pcursor->GetKey(key) && key.first == prefix;
+        if (fValid) {
+            V value;
+            if (!pcursor->GetValue(value))
+                return error("%s: failed to read value", __func__);
+            batchTo.Write(key, value);
+            batchFrom.Erase(key);
+            count++;
+            pcursor->Next();
+        }
+        if (!fValid || batchTo.SizeEstimate() > batch_size) {
+            // the copy has to be durable before the originals go
+            if (!to.WriteBatch(batchTo, true) || !from.WriteBatch(batchFrom))
+                return false;
+            batchTo.Clear();
+            batchFrom.Clear();
+        }
+        if (!fValid)
+            break;
+    }
+
+    if (count > 0) {
+        LogPrintf("%s: moved %u '%c' entries\n", __func__, (unsigned int)count, prefix);
+        // let LevelDB drop the space the moved entries took, without touching the block index between the prefixes
+        from.CompactRange(prefix, (char)(prefix + 1));
+    }
+    return true;
+}
+
+bool CBlockTreeDB::MoveIndexes() {
+    if (!MoveIndexEntries<uint256, CDiskTxPos>(*this, ptxindexdb, DB_TXINDEX) ||
+        !MoveIndexEntries<CAddressIndexKey, CAmount>(*this, paddressindexdb, DB_ADDRESSINDEX) ||
+        !MoveIndexEntries<CAddressUnspentKey, CAddressUnspentValue>(*this, paddressindexdb, DB_ADDRESSUNSPENTINDEX) ||
+        !MoveIndexEntries<CAddressIndexIteratorKey, CAddressBalanceValue>(*this, paddressindexdb, DB_ADDRESSBALANCEINDEX) ||
+        !MoveIndexEntries<CSpentIndexKey, CSpentIndexValue>(*this, pspentindexdb, DB_SPENTINDEX) ||
+        !MoveIndexEntries<CTimestampIndexKey, int>(*this, ptimestampindexdb, DB_TIMESTAMPINDEX))
+        return false;
+    return true;
+}
+
 bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
-    return Read(make_pair(DB_TXINDEX, txid), pos);
+    if (!ptxindexdb)
+        return false;
+    return ptxindexdb->Read(make_pair(DB_TXINDEX, txid), pos);
 }
 
 bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >&vect) {
-    CDBBatch batch(*this);
+    if (!ptxindexdb)
+        return false;
+    CDBBatch batch(*ptxindexdb);
     for (std::vector<std::pair<uint256,CDiskTxPos> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(make_pair(DB_TXINDEX, it->first), it->second);
-    return WriteBatch(batch);
+    fTxIndexDirty = true;
+    return ptxindexdb->WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(make_pair(DB_SPENTINDEX, key), value);
+    if (!pspentindexdb)
+        return false;
+    return pspentindexdb->Read(make_pair(DB_SPENTINDEX, key), value);
 }
 
 bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
+    if (!pspentindexdb)
+        return false;
+    CDBBatch batch(*pspentindexdb);
     for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(make_pair(DB_SPENTINDEX, it->first));
@@ -219,11 +373,14 @@ bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey,
             batch.Write(make_pair(DB_SPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
+    fSpentIndexDirty = true;
+    return pspentindexdb->WriteBatch(batch);
 }
 
 bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CDBBatch batch(*this);
+    if (!paddressindexdb)
+        return false;
+    CDBBatch batch(*paddressindexdb);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
@@ -231,20 +388,37 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddres
             batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
+    fAddressIndexDirty = true;
+    return paddressindexdb->WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                                           CAddressUnspentKey *pnextKey, size_t nLimit) {
 
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    if (!paddressindexdb)
+        return false;
+
+    boost::scoped_ptr<CDBIterator> pcursor(paddressindexdb->NewIterator());
 
-    pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    if (pnextKey && !pnextKey->txhash.IsNull()) {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, *pnextKey));
+        pnextKey->SetNull();
+    } else {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
 
+    size_t nCount = 0;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.type == type && key.second.hashBytes == addressHash) {
+            if (nLimit > 0 && nCount == nLimit) {
+                if (pnextKey)
+                    *pnextKey = key.second;
+                break;
+            }
+            nCount++;
             CAddressUnspentValue nValue;
             if (pcursor->GetValue(nValue)) {
                 unspentOutputs.push_back(make_pair(key.second, nValue));
@@ -261,38 +435,174 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
 }
 
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+    if (!paddressindexdb)
+        return false;
+    CDBBatch batch(*paddressindexdb);
+    std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue> mapBalances;
+    std::vector<std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator> vNew;
+    int nHeight = nAddressIndexHeight;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        // Only blocks connected again after a crash can find their entries on disk, and in the
+        // balances, already. Those are at or below the highest height written so far.
+        if (it->first.blockHeight > nAddressIndexHeight || !paddressindexdb->Exists(make_pair(DB_ADDRESSINDEX, it->first))) {
+            mapBalances[std::make_pair(it->first.type, it->first.hashBytes)];
+            vNew.push_back(it);
+        }
+        nHeight = std::max(nHeight, it->first.blockHeight);
         batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
+    }
+    ReadAddressBalances(mapBalances);
+    for (size_t i = 0; i < vNew.size(); i++)
+        mapBalances[std::make_pair(vNew[i]->first.type, vNew[i]->first.hashBytes)].Apply(vNew[i]->second, false);
+    WriteAddressBalances(batch, mapBalances);
+    if (nHeight > nAddressIndexHeight)
+        batch.Write(DB_ADDRESSINDEX_HEIGHT, nHeight);
+    fAddressIndexDirty = true;
+    if (!paddressindexdb->WriteBatch(batch))
+        return false;
+    nAddressIndexHeight = nHeight;
+    return true;
 }
 
 bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+    if (!paddressindexdb)
+        return false;
+    CDBBatch batch(*paddressindexdb);
+    std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue> mapBalances;
+    std::vector<std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator> vErased;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        // Disconnected blocks are always at or below the highest height written, and may have
+        // been disconnected already before a crash
+        if (paddressindexdb->Exists(make_pair(DB_ADDRESSINDEX, it->first))) {
+            mapBalances[std::make_pair(it->first.type, it->first.hashBytes)];
+            vErased.push_back(it);
+        }
         batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
+    }
+    ReadAddressBalances(mapBalances);
+    for (size_t i = 0; i < vErased.size(); i++)
+        mapBalances[std::make_pair(vErased[i]->first.type, vErased[i]->first.hashBytes)].Apply(vErased[i]->second, true);
+    WriteAddressBalances(batch, mapBalances);
+    fAddressIndexDirty = true;
+    return paddressindexdb->WriteBatch(batch);
+}
+
+void CBlockTreeDB::ReadAddressBalances(std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue> &mapBalances) {
+    // The map is sorted the same way as the balance keys, so one cursor moves forward through all of them
+    boost::scoped_ptr<CDBIterator> pcursor(paddressindexdb->NewIterator());
+    for (std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue>::iterator it=mapBalances.begin(); it!=mapBalances.end(); it++) {
+        pcursor->Seek(make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(it->first.first, it->first.second)));
+        std::pair<char,CAddressIndexIteratorKey> key;
+        // No record just means nothing was indexed for this address yet
+        if (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSBALANCEINDEX &&
+            key.second.type == it->first.first && key.second.hashBytes == it->first.second)
+            pcursor->GetValue(it->second);
+    }
+}
+
+void CBlockTreeDB::WriteAddressBalances(CDBBatch &batch, const std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue> &mapBalances) {
+    for (std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue>::const_iterator it=mapBalances.begin(); it!=mapBalances.end(); it++) {
+        CAddressIndexIteratorKey key(it->first.first, it->first.second);
+        if (it->second.IsNull()) {
+            batch.Erase(make_pair(DB_ADDRESSBALANCEINDEX, key));
+        } else {
+            batch.Write(make_pair(DB_ADDRESSBALANCEINDEX, key), it->second);
+        }
+    }
+}
+
+bool CBlockTreeDB::ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value) {
+    if (!paddressindexdb)
+        return false;
+    value.SetNull();
+    // No record just means nothing was ever indexed for this address
+    paddressindexdb->Read(make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(type, addressHash)), value);
+    return true;
+}
+
+bool CBlockTreeDB::RebuildAddressBalanceIndex() {
+    if (!paddressindexdb)
+        return false;
+    boost::scoped_ptr<CDBIterator> pcursor(paddressindexdb->NewIterator());
+    CDBBatch batch(*paddressindexdb);
+    size_t batch_size = 1 << 24;
+    size_t count = 0;
+
+    std::pair<unsigned int, uint160> address;
+    CAddressBalanceValue value;
+    int nHeight = -1;
+
+    pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey()));
+
+    // Entries are sorted by type and address first, so each address is one contiguous run
+    while (true) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        bool fValid = pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX;
+        if (!fValid || address != std::make_pair(key.second.type, key.second.hashBytes)) {
+            if (count > 0 && !value.IsNull()) {
+                batch.Write(make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(address.first, address.second)), value);
+            }
+            if (batch.SizeEstimate() > batch_size) {
+                if (!paddressindexdb->WriteBatch(batch))
+                    return false;
+                batch.Clear();
+            }
+            if (!fValid)
+                break;
+            address = std::make_pair(key.second.type, key.second.hashBytes);
+            value.SetNull();
+        }
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address index value");
+        value.Apply(nValue, false);
+        nHeight = std::max(nHeight, key.second.blockHeight);
+        count++;
+        pcursor->Next();
+    }
+
+    LogPrintf("%s: built balances from %u address index entries\n", __func__, (unsigned int)count);
+    batch.Write(DB_ADDRESSINDEX_HEIGHT, nHeight);
+    if (!paddressindexdb->WriteBatch(batch, true))
+        return false;
+    nAddressIndexHeight = nHeight;
+    return true;
 }
 
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+                                    int start, int end,
+                                    CAddressIndexKey *pnextKey, size_t nLimit) {
 
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    if (!paddressindexdb)
+        return false;
+
+    boost::scoped_ptr<CDBIterator> pcursor(paddressindexdb->NewIterator());
 
-    if (start > 0 && end > 0) {
+    if (pnextKey && !pnextKey->txhash.IsNull()) {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, *pnextKey));
+        pnextKey->SetNull();
+    } else if (start > 0 && end > 0) {
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
     } else {
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
     }
 
+    size_t nCount = 0;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char,CAddressIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.type == type && key.second.hashBytes == addressHash) {
             if (end > 0 && key.second.blockHeight > end) {
                 break;
             }
+            if (nLimit > 0 && nCount == nLimit) {
+                if (pnextKey)
+                    *pnextKey = key.second;
+                break;
+            }
+            nCount++;
             CAmount nValue;
             if (pcursor->GetValue(nValue)) {
                 addressIndex.push_back(make_pair(key.second, nValue));
@@ -309,14 +619,20 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
 }
 
 bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
+    if (!ptimestampindexdb)
+        return false;
+    CDBBatch batch(*ptimestampindexdb);
     batch.Write(make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
+    fTimestampIndexDirty = true;
+    return ptimestampindexdb->WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes) {
 
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    if (!ptimestampindexdb)
+        return false;
+
+    boost::scoped_ptr<CDBIterator> pcursor(ptimestampindexdb->NewIterator());
 
     pcursor->Seek(make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
 
@@ -11,12 +11,14 @@
 #include "chain.h"
 #include "spentindex.h"
 
+#include <atomic>
 #include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
 
 class CBlockIndex;
 class CCoinsViewDBCursor;
@@ -34,7 +36,7 @@ static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 static const int64_t nMinDbCache = 4;
 //! Max memory allocated to block tree DB specific cache, if no -txindex (MiB)
 static const int64_t nMaxBlockDBCache = 2;
-//! Max memory allocated to block tree DB specific cache, if -txindex (MiB)
+//! Max memory allocated to block tree and index DB specific caches, if any index is enabled (MiB)
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
 static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
@@ -107,16 +109,55 @@ private:
     friend class CCoinsViewDB;
 };
 
-/** Access to the block database (blocks/index/) */
+/** Access to the block database (blocks/index/)
+ *
+ * The optional transaction, address, spent and timestamp indexes each live in
+ * their own database under indexes/, with their own cache, so that their
+ * writes and compactions stay out of the way of the block index. Only the
+ * enabled ones are opened, by OpenIndexes(). They are written without
+ * syncing and only synced by SyncIndexes().
+ */
 class CBlockTreeDB : public CDBWrapper
 {
 public:
-    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    //! nIndexCacheSize is split between the index databases OpenIndexes() opens
+    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, size_t nIndexCacheSize = 0);
 private:
+    bool fMemory;
+    bool fWipeIndexes;
+    size_t nIndexCacheSize;
+
+    //! NULL while the index is disabled
+    boost::scoped_ptr<CDBWrapper> ptxindexdb;
+    boost::scoped_ptr<CDBWrapper> paddressindexdb;
+    boost::scoped_ptr<CDBWrapper> pspentindexdb;
+    boost::scoped_ptr<CDBWrapper> ptimestampindexdb;
+
+    //! Index databases written to since the last SyncIndexes()
+    std::atomic<bool> fTxIndexDirty, fAddressIndexDirty, fSpentIndexDirty, fTimestampIndexDirty;
+
+    //! Highest block height the address index holds entries of, -1 if none, -2 if not recorded
+    int nAddressIndexHeight;
+
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
+    void ReadAddressBalances(std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue> &mapBalances);
+    void WriteAddressBalances(CDBBatch &batch, const std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue> &mapBalances);
+    void OpenIndexDB(boost::scoped_ptr<CDBWrapper> &pdb, const std::string &name, bool fEnabled, size_t nCacheSize, const std::vector<std::string> &vWipe);
 public:
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
+    //! Open the databases of the enabled indexes and close the others, once the index flags are known.
+    //! The databases named in vWipe are emptied.
+    void OpenIndexes(bool fTxIndexIn, bool fAddressIndexIn, bool fSpentIndexIn, bool fTimestampIndexIn, const std::vector<std::string> &vWipe = std::vector<std::string>());
+    //! Make everything written to the index databases durable, call before the chain state is flushed
+    bool SyncIndexes();
+    //! Move index entries written by older versions out of the block database
+    bool MoveIndexes();
+    //! Mark the open index databases as holding the indexes of this block database
+    bool WriteIndexMarkers();
+    //! Collect the open index databases that lost their marker, i.e. were deleted or replaced
+    //! since they were marked. Unmarked block databases get their index databases marked instead.
+    bool CheckIndexMarkers(std::vector<std::string> &vMissing);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindex);
@@ -126,13 +167,24 @@ public:
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
+    //! Read at most nLimit entries (0 = all) starting at *pnextKey if it's set, and leave
+    //! the key to continue from in *pnextKey, or a null key once there is nothing left
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
-                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect,
+                                 CAddressUnspentKey *pnextKey = NULL, size_t nLimit = 0);
     bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    //! Paged the same way as ReadAddressUnspentIndex, a set *pnextKey overrides start
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
+                          int start = 0, int end = 0,
+                          CAddressIndexKey *pnextKey = NULL, size_t nLimit = 0);
+    bool ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value);
+    //! Recompute every address balance from the address index, for databases that predate them
+    bool RebuildAddressBalanceIndex();
+    //! False for address indexes written before their highest block height was recorded, those
+    //! need RebuildAddressBalanceIndex() to record it
+    bool HaveAddressIndexHeight() const { return nAddressIndexHeight >= -1; }
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
     bool WriteFlag(const std::string &name, bool fValue);
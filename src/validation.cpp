@@ -40,8 +40,10 @@
 #include "masternodeman.h"
 #include "masternode-payments.h"
 
+#include <algorithm>
 #include <sstream>
 
+#include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -1058,24 +1060,37 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 }
 
 bool GetAddressIndex(uint160 addressHash, int type,
-                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end,
+                     CAddressIndexKey *pnextKey, size_t nLimit)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end, pnextKey, nLimit))
         return error("unable to get txids for address");
 
     return true;
 }
 
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressBalance(addressHash, type, value))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
 bool GetAddressUnspent(uint160 addressHash, int type,
-                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                       CAddressUnspentKey *pnextKey, size_t nLimit)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs, pnextKey, nLimit))
         return error("unable to get txids for address");
 
     return true;
@@ -1911,11 +1926,17 @@ void static FlushBlockFile(bool fFinalize = false)
 
 bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+/** Shared by script, header and masternode checks, ConnectBlock waits for its turn, the others use RunSharedChecks */
+static CCheckQueue<CAnyCheck> checkqueue(128);
 
 void ThreadScriptCheck() {
     RenameThread("veda-scriptch");
-    scriptcheckqueue.Thread();
+    checkqueue.Thread();
+}
+
+CCheckQueue<CAnyCheck>* GetSharedCheckQueue()
+{
+    return nScriptCheckThreads ? &checkqueue : NULL;
 }
 
 // Protected by cs_main
@@ -1999,6 +2020,75 @@ static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
+/** Add the address and spent index entries of input j of transaction i, which spends prevout at outpoint */
+static void IndexSpentOutput(const CTxOut& prevout, const COutPoint& outpoint, const uint256& txhash, unsigned int i, size_t j, int nHeight,
+                             bool fAddress, bool fSpent,
+                             std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                             std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& addressUnspentIndex,
+                             std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >& spentIndex)
+{
+    uint160 hashBytes;
+    int addressType;
+
+    if (prevout.scriptPubKey.IsPayToScriptHash()) {
+        hashBytes = uint160(vector <unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
+        addressType = 2;
+    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
+        hashBytes = uint160(vector <unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
+        addressType = 1;
+    } else {
+        hashBytes.SetNull();
+        addressType = 0;
+    }
+
+    if (fAddress && addressType > 0) {
+        // record spending activity
+        addressIndex.push_back(make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, i, txhash, j, true), prevout.nValue * -1));
+
+        // remove address from unspent index
+        addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(addressType, hashBytes, outpoint.hash, outpoint.n), CAddressUnspentValue()));
+    }
+
+    if (fSpent) {
+        // add the spent index to determine the txid and input that spent an output
+        // and to find the amount and address from an input
+        spentIndex.push_back(make_pair(CSpentIndexKey(outpoint.hash, outpoint.n), CSpentIndexValue(txhash, j, nHeight, prevout.nValue, addressType, hashBytes)));
+    }
+}
+
+/** Add the address index entries of the outputs of transaction i */
+static void IndexOutputs(const CTransaction& tx, const uint256& txhash, unsigned int i, int nHeight,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                         std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& addressUnspentIndex)
+{
+    for (unsigned int k = 0; k < tx.vout.size(); k++) {
+        const CTxOut &out = tx.vout[k];
+
+        if (out.scriptPubKey.IsPayToScriptHash()) {
+            vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
+
+            // record receiving activity
+            addressIndex.push_back(make_pair(CAddressIndexKey(2, uint160(hashBytes), nHeight, i, txhash, k, false), out.nValue));
+
+            // record unspent output
+            addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight)));
+
+        } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
+            vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
+
+            // record receiving activity
+            addressIndex.push_back(make_pair(CAddressIndexKey(1, uint160(hashBytes), nHeight, i, txhash, k, false), out.nValue));
+
+            // record unspent output
+            addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight)));
+
+        } else {
+            continue;
+        }
+
+    }
+}
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
@@ -2121,7 +2211,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     CBlockUndo blockundo;
 
-    CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : NULL);
+    CCheckQueueControl<CAnyCheck> control(fScriptChecks && nScriptCheckThreads ? &checkqueue : NULL);
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
@@ -2169,39 +2259,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
             if (fAddressIndex || fSpentIndex)
             {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-                    const CTxIn input = tx.vin[j];
-                    const Coin& coin = view.AccessCoin(tx.vin[j].prevout);
-                    const CTxOut &prevout = coin.out;
-                    uint160 hashBytes;
-                    int addressType;
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        hashBytes = uint160(vector <unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        hashBytes = uint160(vector <unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
-                        addressType = 1;
-                    } else {
-                        hashBytes.SetNull();
-                        addressType = 0;
-                    }
-
-                    if (fAddressIndex && addressType > 0) {
-                        // record spending activity
-                        addressIndex.push_back(make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
-
-                        // remove address from unspent index
-                        addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                    }
-
-                    if (fSpentIndex) {
-                        // add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input
-                        spentIndex.push_back(make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
-                    }
-                }
-
+                for (size_t j = 0; j < tx.vin.size(); j++)
+                    IndexSpentOutput(view.AccessCoin(tx.vin[j].prevout).out, tx.vin[j].prevout, txhash, i, j, pindex->nHeight,
+                                     fAddressIndex, fSpentIndex, addressIndex, addressUnspentIndex, spentIndex);
             }
 
             if (fStrictPayToScriptHash)
@@ -2225,34 +2285,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             control.Add(vChecks);
         }
 
-        if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // record receiving activity
-                    addressIndex.push_back(make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // record receiving activity
-                    addressIndex.push_back(make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else {
-                    continue;
-                }
-
-            }
-        }
+        if (fAddressIndex)
+            IndexOutputs(tx, txhash, i, pindex->nHeight, addressIndex, addressUnspentIndex);
 
         CTxUndo undoDummy;
         if (i > 0) {
@@ -2425,6 +2459,10 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                 vBlocks.push_back(*it);
                 setDirtyBlockIndex.erase(it++);
             }
+            // The index databases are written without syncing, they catch up here
+            if (!pblocktree->SyncIndexes()) {
+                return AbortNode(state, "Failed to write to transaction index databases");
+            }
             if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                 return AbortNode(state, "Files to write to block index database");
             }
@@ -2573,6 +2611,7 @@ bool static DisconnectTip(CValidationState& state, const Consensus::Params& cons
     BOOST_FOREACH(const CTransaction &tx, block.vtx) {
         GetMainSignals().SyncTransaction(tx, NULL);
     }
+    GetMainSignals().BlockDisconnected(block);
     return true;
 }
 
@@ -2635,6 +2674,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     BOOST_FOREACH(const CTransaction &tx, pblock->vtx) {
         GetMainSignals().SyncTransaction(tx, pblock);
     }
+    GetMainSignals().BlockConnected(*pblock, pindexNew);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
     LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
@@ -2987,10 +3027,9 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex *pindex) {
     return true;
 }
 
-CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256& hash)
 {
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator it = mapBlockIndex.find(hash);
     if (it != mapBlockIndex.end())
         return it->second;
@@ -3021,6 +3060,11 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
     return pindexNew;
 }
 
+CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+{
+    return AddToBlockIndex(block, block.GetHash());
+}
+
 /** Mark a block as having its data received and checked (up to BLOCK_VALID_TRANSACTIONS). */
 bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBlockIndex *pindexNew, const CDiskBlockPos& pos)
 {
@@ -3381,11 +3425,14 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+/**
+ * Accept a header whose hash has already been computed. fCheckPOW is false when
+ * the caller has already verified the proof of work for this hash.
+ */
+static bool AcceptBlockHeader(const CBlockHeader& block, const uint256& hash, bool fCheckPOW, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = NULL;
 
@@ -3402,7 +3449,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state))
+        if (!CheckBlockHeader(block, state, fCheckPOW))
             return false;
 
         // Get prev block index
@@ -3422,7 +3469,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return false;
     }
     if (pindex == NULL)
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(block, hash);
 
     if (ppindex)
         *ppindex = pindex;
@@ -3435,13 +3482,83 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
     return true;
 }
 
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+{
+    return AcceptBlockHeader(block, block.GetHash(), true, state, chainparams, ppindex);
+}
+
+/** Number of headers hashed by one check, enough to outweigh handing it to a check thread */
+static const size_t HEADER_CHECK_SLICE_SIZE = 8;
+
+/**
+ * Closure hashing a slice of a HEADERS message and checking each header's
+ * proof of work ahead of contextual validation. Results go to caller-owned
+ * slots so the outcome of every header is known, not only whether all passed.
+ */
+class CHeaderPoWCheck
+{
+private:
+    const CBlockHeader* pheaders;
+    uint256* phashes;
+    unsigned char* pfPoWValid;
+    size_t nCount;
+    const Consensus::Params* pparams;
+
+public:
+    CHeaderPoWCheck(): pheaders(NULL), phashes(NULL), pfPoWValid(NULL), nCount(0), pparams(NULL) {}
+    CHeaderPoWCheck(const CBlockHeader* pheadersIn, uint256* phashesIn, unsigned char* pfPoWValidIn, size_t nCountIn, const Consensus::Params& params) :
+        pheaders(pheadersIn), phashes(phashesIn), pfPoWValid(pfPoWValidIn), nCount(nCountIn), pparams(&params) {}
+
+    bool operator()() {
+        for (size_t i = 0; i < nCount; i++) {
+            phashes[i] = pheaders[i].GetHash();
+            pfPoWValid[i] = CheckProofOfWork(phashes[i], pheaders[i].nBits, *pparams);
+        }
+        // A failed header is reported through pfPoWValid, the rest of the batch still has to run
+        return true;
+    }
+
+    void swap(CHeaderPoWCheck& check) {
+        std::swap(pheaders, check.pheaders);
+        std::swap(phashes, check.phashes);
+        std::swap(pfPoWValid, check.pfPoWValid);
+        std::swap(nCount, check.nCount);
+        std::swap(pparams, check.pparams);
+    }
+};
+
+/**
+ * Compute the hash of every header and check its proof of work without holding
+ * cs_main, spreading the work over the shared check threads when they are free.
+ */
+static void PreCheckBlockHeaders(const std::vector<CBlockHeader>& headers, std::vector<uint256>& vHashes, std::vector<unsigned char>& vPoWValid, const Consensus::Params& params)
+{
+    vHashes.resize(headers.size());
+    vPoWValid.assign(headers.size(), 0);
+
+    std::vector<CHeaderPoWCheck> vChecks;
+    vChecks.reserve((headers.size() + HEADER_CHECK_SLICE_SIZE - 1) / HEADER_CHECK_SLICE_SIZE);
+    for (size_t i = 0; i < headers.size(); i += HEADER_CHECK_SLICE_SIZE) {
+        size_t nCount = std::min(HEADER_CHECK_SLICE_SIZE, headers.size() - i);
+        vChecks.push_back(CHeaderPoWCheck(&headers[i], &vHashes[i], &vPoWValid[i], nCount, params));
+    }
+
+    RunSharedChecks(GetSharedCheckQueue(), vChecks);
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
 {
+    std::vector<uint256> vHashes;
+    std::vector<unsigned char> vPoWValid;
+    PreCheckBlockHeaders(headers, vHashes, vPoWValid, chainparams.GetConsensus());
+
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
-            if (!AcceptBlockHeader(header, state, chainparams, ppindex)) {
+        for (size_t i = 0; i < headers.size(); i++) {
+            // Headers that failed the pre-check go through CheckBlockHeader's own
+            // proof of work check so they are rejected exactly as before
+            if (!AcceptBlockHeader(headers[i], vHashes[i], !vPoWValid[i], state, chainparams, ppindex)) {
                 return false;
             }
         }
@@ -3760,6 +3877,127 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
     return pindexNew;
 }
 
+void ThreadVerifyBlockIndexHashes()
+{
+    RenameThread("veda-idxhash");
+    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+
+    std::vector<CBlockIndex*> vIndexes;
+    {
+        LOCK(cs_main);
+        vIndexes.reserve(mapBlockIndex.size());
+        BOOST_FOREACH(const PAIRTYPE(uint256, CBlockIndex*)& item, mapBlockIndex)
+            vIndexes.push_back(item.second);
+    }
+    LogPrintf("%s: verifying hashes of %u block index entries\n", __func__, vIndexes.size());
+    int64_t nStart = GetTimeMillis();
+
+    // CBlockIndex objects are never freed while running, only cs_main is needed to read them.
+    // Headers are copied in small chunks so cs_main is only held briefly.
+    static const size_t nChunkSize = 1000;
+    std::vector<CBlockHeader> vHeaders;
+    std::vector<uint256> vExpected;
+    unsigned int nMismatches = 0;
+    for (size_t nStartPos = 0; nStartPos < vIndexes.size(); nStartPos += nChunkSize) {
+        boost::this_thread::interruption_point();
+        size_t nEnd = std::min(vIndexes.size(), nStartPos + nChunkSize);
+        vHeaders.clear();
+        vExpected.clear();
+        {
+            LOCK(cs_main);
+            for (size_t i = nStartPos; i < nEnd; i++) {
+                // Headers of entries only referenced as pprev have not been loaded
+                if (vIndexes[i]->nBits == 0)
+                    continue;
+                vHeaders.push_back(vIndexes[i]->GetBlockHeader());
+                vExpected.push_back(vIndexes[i]->GetBlockHash());
+            }
+        }
+        for (size_t i = 0; i < vHeaders.size(); i++) {
+            uint256 hash = vHeaders[i].GetHash();
+            if (hash != vExpected[i]) {
+                LogPrintf("%s: block index entry %s has a header hashing to %s\n", __func__, vExpected[i].ToString(), hash.ToString());
+                nMismatches++;
+            }
+        }
+        // leave the cores to validation, this pass is not urgent
+        MilliSleep(1);
+    }
+
+    if (nMismatches) {
+        LogPrintf("%s: %u block index entries do not match their headers, restart with -reindex\n", __func__, nMismatches);
+        return;
+    }
+    LogPrintf("%s: all block index hashes verified in %dms\n", __func__, GetTimeMillis() - nStart);
+}
+
+/**
+ * Write the entries of the given indexes again from the block and undo files, the way
+ * ConnectBlock() writes them, for the chain ending at the coins tip. The other indexes
+ * are left alone.
+ */
+static bool RebuildIndexesFromBlocks(const CChainParams& chainparams, bool fTx, bool fAddress, bool fSpent, bool fTimestamp)
+{
+    BlockMap::iterator mi = mapBlockIndex.find(pcoinsTip->GetBestBlock());
+    if (mi == mapBlockIndex.end())
+        return true;
+    std::vector<CBlockIndex*> vChain;
+    for (CBlockIndex* pindex = mi->second; pindex->pprev; pindex = pindex->pprev)
+        vChain.push_back(pindex);
+    std::reverse(vChain.begin(), vChain.end());
+
+    BOOST_FOREACH(CBlockIndex* pindex, vChain) {
+        boost::this_thread::interruption_point();
+        if (pindex->nHeight % 10000 == 0)
+            LogPrintf("%s: at height %d of %d\n", __func__, pindex->nHeight, mi->second->nHeight);
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        // the undo data holds the outputs the block spent
+        CBlockUndo blockundo;
+        if (fAddress || fSpent) {
+            CDiskBlockPos pos = pindex->GetUndoPos();
+            if (pos.IsNull() || !UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash()))
+                return error("%s: failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+            if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+                return error("%s: undo data of block %s does not match it", __func__, pindex->GetBlockHash().ToString());
+        }
+
+        CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
+        std::vector<std::pair<uint256, CDiskTxPos> > vPos;
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+        std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+        for (unsigned int i = 0; i < block.vtx.size(); i++) {
+            const CTransaction &tx = block.vtx[i];
+            const uint256 txhash = tx.GetHash();
+            if (i > 0 && (fAddress || fSpent)) {
+                const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+                if (txundo.vprevout.size() != tx.vin.size())
+                    return error("%s: undo data of block %s does not match it", __func__, pindex->GetBlockHash().ToString());
+                for (size_t j = 0; j < tx.vin.size(); j++)
+                    IndexSpentOutput(txundo.vprevout[j].out, tx.vin[j].prevout, txhash, i, j, pindex->nHeight,
+                                     fAddress, fSpent, addressIndex, addressUnspentIndex, spentIndex);
+            }
+            if (fAddress)
+                IndexOutputs(tx, txhash, i, pindex->nHeight, addressIndex, addressUnspentIndex);
+            vPos.push_back(std::make_pair(txhash, pos));
+            pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
+        }
+
+        if (fTx && !pblocktree->WriteTxIndex(vPos))
+            return error("%s: failed to write transaction index", __func__);
+        if (fAddress && (!pblocktree->WriteAddressIndex(addressIndex) || !pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)))
+            return error("%s: failed to write address index", __func__);
+        if (fSpent && !pblocktree->UpdateSpentIndex(spentIndex))
+            return error("%s: failed to write spent index", __func__);
+        if (fTimestamp && !pblocktree->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
+            return error("%s: failed to write timestamp index", __func__);
+    }
+    return pblocktree->SyncIndexes();
+}
+
 bool static LoadBlockIndexDB()
 {
     const CChainParams& chainparams = Params();
@@ -3866,6 +4104,42 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+    pblocktree->OpenIndexes(fTxIndex, fAddressIndex, fSpentIndex, fTimestampIndex);
+
+    // Older versions kept the transaction indexes in the block database itself
+    if (!pblocktree->MoveIndexes())
+        return error("%s: failed to move transaction indexes out of the block database", __func__);
+
+    // An index database that went missing or was replaced is emptied and written again from the block files
+    std::vector<std::string> vMissingIndexes;
+    if (!pblocktree->CheckIndexMarkers(vMissingIndexes))
+        return error("%s: failed to mark the index databases", __func__);
+    if (!vMissingIndexes.empty()) {
+        std::string strMissing = boost::algorithm::join(vMissingIndexes, ", ");
+        if (fHavePruned)
+            return error("%s: index database %s is missing or empty and block files were pruned, restart with -reindex", __func__, strMissing);
+        LogPrintf("%s: rebuilding index database %s from the block files...\n", __func__, strMissing);
+        pblocktree->OpenIndexes(fTxIndex, fAddressIndex, fSpentIndex, fTimestampIndex, vMissingIndexes);
+        bool fTx = std::count(vMissingIndexes.begin(), vMissingIndexes.end(), "txindex");
+        bool fAddress = std::count(vMissingIndexes.begin(), vMissingIndexes.end(), "addressindex");
+        bool fSpent = std::count(vMissingIndexes.begin(), vMissingIndexes.end(), "spentindex");
+        bool fTimestamp = std::count(vMissingIndexes.begin(), vMissingIndexes.end(), "timestampindex");
+        if (!RebuildIndexesFromBlocks(Params(), fTx, fAddress, fSpent, fTimestamp))
+            return error("%s: failed to rebuild index database %s, restart with -reindex", __func__, strMissing);
+        if (!pblocktree->WriteIndexMarkers())
+            return error("%s: failed to mark the index databases", __func__);
+    }
+
+    // Address indexes written before balances and the highest indexed height were kept need them computed once
+    bool fAddressBalanceIndex = false;
+    pblocktree->ReadFlag("addressbalanceindex", fAddressBalanceIndex);
+    if (fAddressIndex && (!fAddressBalanceIndex || !pblocktree->HaveAddressIndexHeight())) {
+        LogPrintf("%s: building address balance index...\n", __func__);
+        if (!pblocktree->RebuildAddressBalanceIndex())
+            return error("%s: failed to build address balance index", __func__);
+        pblocktree->WriteFlag("addressbalanceindex", true);
+    }
+
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end())
@@ -4024,6 +4298,8 @@ bool InitBlockIndex(const CChainParams& chainparams)
     // Use the provided setting for -addressindex in the new database
     fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
     pblocktree->WriteFlag("addressindex", fAddressIndex);
+    // A new address index keeps its balances from the first block on
+    pblocktree->WriteFlag("addressbalanceindex", true);
 
     // Use the provided setting for -timestampindex in the new database
     fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
@@ -4032,6 +4308,10 @@ bool InitBlockIndex(const CChainParams& chainparams)
     fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     pblocktree->WriteFlag("spentindex", fSpentIndex);
 
+    pblocktree->OpenIndexes(fTxIndex, fAddressIndex, fSpentIndex, fTimestampIndex);
+    if (!pblocktree->WriteIndexMarkers())
+        return error("%s: failed to mark the index databases", __func__);
+
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -34,6 +34,7 @@
 #include <boost/unordered_map.hpp>
 #include <boost/filesystem/path.hpp>
 
+class CAnyCheck;
 class CBlockIndex;
 class CBlockTreeDB;
 class CBloomFilter;
@@ -48,6 +49,9 @@ class CValidationState;
 
 struct LockPoints;
 
+template <typename T>
+class CCheckQueue;
+
 /** Default for accepting alerts from the P2P network. */
 static const bool DEFAULT_ALERTS = true;
 /** Default for DEFAULT_WHITELISTRELAY. */
@@ -129,6 +133,12 @@ static const bool DEFAULT_ENABLE_REPLACEMENT = false;
 /** Maximum number of headers to announce when relaying blocks with headers message.*/
 static const unsigned int MAX_BLOCKS_TO_ANNOUNCE = 8;
 
+/** Maximum depth of blocks we're willing to serve as compact blocks to peers
+ *  when requested. For older blocks, a regular BLOCK response will be sent. */
+static const int MAX_CMPCTBLOCK_DEPTH = 5;
+/** Maximum depth of blocks we're willing to respond to GETBLOCKTXN requests for. */
+static const int MAX_BLOCKTXN_DEPTH = 10;
+
 struct BlockHasher
 {
     size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
@@ -187,6 +197,8 @@ static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 
 static const signed int DEFAULT_CHECKBLOCKS = MIN_BLOCKS_TO_KEEP;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
+/** Default for -verifyblockindexhashes, re-hash all loaded block index headers in the background */
+static const bool DEFAULT_VERIFY_BLOCK_INDEX_HASHES = false;
 
 // Require that user allocate at least 945MB for block & undo files (blk???.dat and rev???.dat)
 // At 2MB per block, 288 blocks = 576MB.
@@ -244,8 +256,12 @@ bool InitBlockIndex(const CChainParams& chainparams);
 bool LoadBlockIndex();
 /** Unload database information */
 void UnloadBlockIndex();
-/** Run an instance of the script checking thread */
+/** Run an instance of the script checking thread, which also takes header and masternode checks */
 void ThreadScriptCheck();
+/** The queue of the script checking threads for RunSharedChecks, NULL if there are no such threads */
+CCheckQueue<CAnyCheck>* GetSharedCheckQueue();
+/** Re-hash every header in mapBlockIndex at low priority and log entries not matching the hash they were loaded under */
+void ThreadVerifyBlockIndexHashes();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -416,9 +432,12 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::v
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool GetAddressIndex(uint160 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                     int start = 0, int end = 0);
+                     int start = 0, int end = 0,
+                     CAddressIndexKey *pnextKey = NULL, size_t nLimit = 0);
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value);
 bool GetAddressUnspent(uint160 addressHash, int type,
-                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                       CAddressUnspentKey *pnextKey = NULL, size_t nLimit = 0);
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
@@ -4,6 +4,11 @@
 
 #include "wallet/wallet.h"
 
+#include "consensus/validation.h"
+#include "random.h"
+#include "script/interpreter.h"
+#include "validation.h"
+
 #include <set>
 #include <stdint.h>
 #include <utility>
@@ -361,4 +366,184 @@ BOOST_AUTO_TEST_CASE(ApproximateBestSubset)
     BOOST_CHECK_EQUAL(setCoinsRet.size(), 101);
 }
 
+BOOST_FIXTURE_TEST_CASE(wallet_balances, TestChain100Setup)
+{
+    CWallet wallet;
+    {
+        LOCK(wallet.cs_wallet);
+        wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+    }
+    wallet.ScanForWalletTransactions(chainActive.Genesis());
+
+    CAmount nTotal = 0;
+    BOOST_FOREACH(const CTransaction& tx, coinbaseTxns)
+        nTotal += wallet.GetCredit(tx, ISMINE_SPENDABLE);
+    CAmount nFirst = wallet.GetCredit(coinbaseTxns[0], ISMINE_SPENDABLE);
+    BOOST_CHECK(nFirst > 0);
+
+    // none of the coinbases is mature yet
+    CWalletBalances balances = wallet.GetBalances();
+    BOOST_CHECK_EQUAL(balances.nBalance, 0);
+    BOOST_CHECK_EQUAL(balances.nImmatureBalance, nTotal);
+
+    // the first one matures with the next block, without any wallet event
+    CreateAndProcessBlock(std::vector<CMutableTransaction>(), CScript() << OP_TRUE);
+    balances = wallet.GetBalances();
+    BOOST_CHECK_EQUAL(balances.nBalance, nFirst);
+    BOOST_CHECK_EQUAL(balances.nImmatureBalance, nTotal - nFirst);
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), nFirst);
+    BOOST_CHECK_EQUAL(wallet.GetImmatureBalance(), nTotal - nFirst);
+
+    // and is immature again once that block is disconnected
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params().GetConsensus(), chainActive.Tip()));
+    }
+    balances = wallet.GetBalances();
+    BOOST_CHECK_EQUAL(balances.nBalance, 0);
+    BOOST_CHECK_EQUAL(balances.nImmatureBalance, nTotal);
+}
+
+BOOST_FIXTURE_TEST_CASE(wallet_available_coins, TestChain100Setup)
+{
+    CWallet wallet;
+    {
+        LOCK(wallet.cs_wallet);
+        wallet.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+    }
+    wallet.ScanForWalletTransactions(chainActive.Genesis());
+
+    std::vector<COutput> vCoins;
+    wallet.AvailableCoins(vCoins);
+    BOOST_CHECK(vCoins.empty());
+
+    // split the first coinbase in a block that also matures it
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+    spend.vout.resize(2);
+    spend.vout[0].nValue = 11 * CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    spend.vout[1].nValue = 12 * CENT;
+    spend.vout[1].scriptPubKey = scriptPubKey;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    CBlock block = CreateAndProcessBlock(std::vector<CMutableTransaction>(1, spend), CScript() << OP_TRUE);
+    BOOST_CHECK_EQUAL(block.vtx.size(), 2);
+
+    // the wallet hasn't seen the spend yet, the coinbase matured without any wallet event
+    vCoins.clear();
+    wallet.AvailableCoins(vCoins);
+    BOOST_CHECK_EQUAL(vCoins.size(), 1);
+    BOOST_CHECK(vCoins.size() == 1 && vCoins[0].tx->GetHash() == coinbaseTxns[0].GetHash());
+
+    // once it has, only the outputs of the spend are left (adding it only fails writing it out)
+    {
+        LOCK2(cs_main, wallet.cs_wallet);
+        wallet.AddToWalletIfInvolvingMe(block.vtx[1], &block, true);
+    }
+    vCoins.clear();
+    wallet.AvailableCoins(vCoins);
+    BOOST_CHECK_EQUAL(vCoins.size(), 2);
+    CAmount nTotal = 0;
+    BOOST_FOREACH(const COutput& out, vCoins) {
+        BOOST_CHECK(out.tx->GetHash() == block.vtx[1].GetHash());
+        nTotal += out.tx->vout[out.i].nValue;
+    }
+    BOOST_CHECK_EQUAL(nTotal, 23 * CENT);
+}
+
+static CMutableTransaction PrivateSendTx(const COutPoint& prevout, const CScript& scriptPubKey, const std::vector<CAmount>& vValues)
+{
+    CMutableTransaction tx;
+    tx.vin.push_back(CTxIn(prevout));
+    BOOST_FOREACH(const CAmount& nValue, vValues)
+        tx.vout.push_back(CTxOut(nValue, scriptPubKey));
+    return tx;
+}
+
+static void AddPrivateSendTx(CWallet& wallet, const CMutableTransaction& tx)
+{
+    CWalletDB walletdb(wallet.strWalletFile);
+    BOOST_CHECK(wallet.AddToWallet(CWalletTx(&wallet, tx), false, &walletdb));
+}
+
+BOOST_AUTO_TEST_CASE(wallet_privatesend_rounds)
+{
+    CPrivateSend::InitStandardDenominations();
+    CKey key;
+    key.MakeNewKey(true);
+    CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+
+    CAmount nDenom = COIN + 1000;
+    CMutableTransaction tx0 = PrivateSendTx(COutPoint(GetRandHash(), 0), scriptPubKey, {nDenom, 5 * COIN});
+    CMutableTransaction tx1 = PrivateSendTx(COutPoint(tx0.GetHash(), 0), scriptPubKey, {nDenom, nDenom});
+    CMutableTransaction tx2 = PrivateSendTx(COutPoint(tx1.GetHash(), 0), scriptPubKey, {nDenom});
+
+    {
+        // the test fixture's mock db keeps the wallet file in memory
+        CWallet wallet("wallet_psrounds.dat");
+        bool fFirstRun;
+        BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+        LOCK2(cs_main, wallet.cs_wallet);
+        wallet.AddKeyPubKey(key, key.GetPubKey());
+        AddPrivateSendTx(wallet, tx0);
+        AddPrivateSendTx(wallet, tx1);
+        AddPrivateSendTx(wallet, tx2);
+
+        BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(tx0.GetHash(), 1), 0), -2);
+        BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(tx1.GetHash(), 1), 0), 1);
+        BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(tx2.GetHash(), 0), 0), 2);
+        BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(tx1.GetHash(), 0), 0), 1);
+
+        // rounds computed when a tx is added are written with it, spent outputs keep theirs
+        CWalletDB walletdb(wallet.strWalletFile);
+        int nRounds = -10;
+        BOOST_CHECK(walletdb.ReadPrivateSendRounds(COutPoint(tx2.GetHash(), 0), nRounds));
+        BOOST_CHECK_EQUAL(nRounds, 2);
+        BOOST_CHECK(walletdb.ReadPrivateSendRounds(COutPoint(tx1.GetHash(), 0), nRounds));
+        BOOST_CHECK_EQUAL(nRounds, 1);
+        BOOST_CHECK(walletdb.ReadPrivateSendRounds(COutPoint(tx0.GetHash(), 0), nRounds));
+        BOOST_CHECK_EQUAL(nRounds, 0);
+    }
+
+    {
+        // and come back with the wallet
+        CWallet wallet("wallet_psrounds.dat");
+        bool fFirstRun;
+        BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+        LOCK2(cs_main, wallet.cs_wallet);
+        BOOST_CHECK_EQUAL(wallet.mapWallet.size(), 3);
+        BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(tx2.GetHash(), 0), 0), 2);
+        BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(tx1.GetHash(), 0), 0), 1);
+    }
+
+    {
+        // mixing txes showing up newest first get their rounds fixed once their inputs arrive
+        CWallet wallet("wallet_psrounds_reverse.dat");
+        bool fFirstRun;
+        BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+        LOCK2(cs_main, wallet.cs_wallet);
+        wallet.AddKeyPubKey(key, key.GetPubKey());
+        AddPrivateSendTx(wallet, tx2);
+        BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(tx2.GetHash(), 0), 0), 0);
+        AddPrivateSendTx(wallet, tx1);
+        BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(tx2.GetHash(), 0), 0), 1);
+        AddPrivateSendTx(wallet, tx0);
+        BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(tx1.GetHash(), 1), 0), 1);
+        BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(tx2.GetHash(), 0), 0), 2);
+
+        // the stale rounds of the txes that arrived first were replaced on disk as well
+        CWalletDB walletdb(wallet.strWalletFile);
+        int nRounds = -10;
+        BOOST_CHECK(walletdb.ReadPrivateSendRounds(COutPoint(tx2.GetHash(), 0), nRounds));
+        BOOST_CHECK_EQUAL(nRounds, 2);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -47,6 +47,7 @@ CAmount maxTxFee = DEFAULT_TRANSACTION_MAXFEE;
 unsigned int nTxConfirmTarget = DEFAULT_TX_CONFIRM_TARGET;
 bool bSpendZeroConfChange = DEFAULT_SPEND_ZEROCONF_CHANGE;
 bool fSendFreeTransactions = DEFAULT_SEND_FREE_TRANSACTIONS;
+bool fCheckWalletBalances = DEFAULT_CHECK_WALLET_BALANCES;
 
 /** 
  * Fees smaller than this (in duffs) are considered zero fee (for transaction creation)
@@ -588,6 +589,11 @@ set<uint256> CWallet::GetConflicts(const uint256& txid) const
 
 void CWallet::Flush(bool shutdown)
 {
+    {
+        LOCK(cs_wallet);
+        // rounds looked up since the last wallet tx was added
+        WriteOutpointPrivateSendRounds(NULL);
+    }
     bitdb.Flush(shutdown);
 }
 
@@ -701,7 +707,7 @@ bool CWallet::IsSpent(const uint256& hash, unsigned int n) const
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(make_pair(outpoint, wtxid));
-    setWalletUTXO.erase(outpoint);
+    setWalletUTXODirty.insert(outpoint.hash);
 
     pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
@@ -869,6 +875,8 @@ void CWallet::MarkDirty()
 {
     {
         LOCK(cs_wallet);
+        fBalancesRebuild = true;
+        setBalanceDirty.clear();
         BOOST_FOREACH(PAIRTYPE(const uint256, CWalletTx)& item, mapWallet)
             item.second.MarkDirty();
     }
@@ -956,11 +964,16 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
                              wtxIn.hashBlock.ToString());
             }
             AddToSpends(hash);
-            for(int i = 0; i < wtx.vout.size(); ++i) {
-                if (IsMine(wtx.vout[i]) && !IsSpent(hash, i)) {
-                    setWalletUTXO.insert(COutPoint(hash, i));
-                }
+            setWalletUTXODirty.insert(hash);
+            // a parent showing up after its spenders invalidates their cached rounds
+            EraseSpendersPrivateSendRounds(hash, pwalletdb);
+            // rounds of new mixing outputs build on the already cached rounds of their inputs
+            for (unsigned int i = 0; i < wtx.vout.size(); ++i) {
+                if (CPrivateSend::IsDenominatedAmount(wtx.vout[i].nValue) && IsMine(wtx.vout[i]))
+                    GetRealOutpointPrivateSendRounds(COutPoint(hash, i), 0);
             }
+            // together with whatever lookups since the last tx computed
+            WriteOutpointPrivateSendRounds(pwalletdb);
         }
 
         bool fUpdated = false;
@@ -1238,11 +1251,89 @@ CAmount CWallet::GetDebit(const CTxIn &txin, const isminefilter& filter) const
     return 0;
 }
 
+int CWallet::SetOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds) const
+{
+    mapOutpointRounds[outpoint] = nRounds;
+    setOutpointRoundsUnsaved.insert(outpoint);
+    LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", outpoint.hash.ToString(), outpoint.n, nRounds);
+    return nRounds;
+}
+
+void CWallet::WriteOutpointPrivateSendRounds(CWalletDB* pwalletdb)
+{
+    AssertLockHeld(cs_wallet);
+    if (setOutpointRoundsUnsaved.empty())
+        return;
+
+    if (fFileBacked) {
+        CWalletDB* pwalletdbRounds = pwalletdb ? pwalletdb : new CWalletDB(strWalletFile);
+        BOOST_FOREACH(const COutPoint& outpoint, setOutpointRoundsUnsaved) {
+            std::map<COutPoint, int>::const_iterator it = mapOutpointRounds.find(outpoint);
+            if (it != mapOutpointRounds.end())
+                pwalletdbRounds->WritePrivateSendRounds(outpoint, it->second);
+        }
+        if (!pwalletdb)
+            delete pwalletdbRounds;
+    }
+    setOutpointRoundsUnsaved.clear();
+}
+
+void CWallet::ErasePrivateSendRounds(const COutPoint& outpoint, CWalletDB* pwalletdb)
+{
+    AssertLockHeld(cs_wallet);
+    std::map<COutPoint, int>::iterator it = mapOutpointRounds.find(outpoint);
+    if (it == mapOutpointRounds.end())
+        return;
+    LogPrint("privatesend", "ErasePrivateSendRounds -- erasing %s\n", outpoint.ToStringShort());
+    // entries still queued for writing have never reached the db
+    if (!setOutpointRoundsUnsaved.erase(outpoint) && fFileBacked && pwalletdb)
+        pwalletdb->ErasePrivateSendRounds(outpoint);
+    mapOutpointRounds.erase(it);
+}
+
+void CWallet::EraseSpendersPrivateSendRounds(const uint256& hash, CWalletDB* pwalletdb)
+{
+    AssertLockHeld(cs_wallet);
+
+    // rounds are only derived from cached rounds, so the walk stops at spenders with nothing cached
+    std::set<uint256> setDone;
+    std::vector<uint256> vTodo(1, hash);
+    while (!vTodo.empty()) {
+        uint256 hashTx = vTodo.back();
+        vTodo.pop_back();
+        const CWalletTx* wtx = GetWalletTx(hashTx);
+        if (wtx == NULL)
+            continue;
+
+        for (unsigned int i = 0; i < wtx->vout.size(); i++) {
+            std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(COutPoint(hashTx, i));
+            for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
+                const uint256& hashSpender = it->second;
+                if (!setDone.insert(hashSpender).second)
+                    continue;
+                bool fErased = false;
+                std::map<COutPoint, int>::iterator itRounds = mapOutpointRounds.lower_bound(COutPoint(hashSpender, 0));
+                while (itRounds != mapOutpointRounds.end() && itRounds->first.hash == hashSpender) {
+                    ErasePrivateSendRounds((itRounds++)->first, pwalletdb);
+                    fErased = true;
+                }
+                if (fErased) {
+                    setWalletUTXODirty.insert(hashSpender);
+                    vTodo.push_back(hashSpender);
+                }
+            }
+        }
+    }
+}
+
+void CWallet::LoadPrivateSendRounds(const COutPoint& outpoint, int nRounds)
+{
+    mapOutpointRounds[outpoint] = nRounds;
+}
+
 // Recursively determine the rounds of a given input (How deep is the PrivateSend chain for a given input)
 int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds) const
 {
-    static std::map<uint256, CMutableTransaction> mDenomWtxes;
-
     if(nRounds >= 16) return 15; // 16 rounds max
 
     uint256 hash = outpoint.hash;
@@ -1251,17 +1342,12 @@ int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRo
     const CWalletTx* wtx = GetWalletTx(hash);
     if(wtx != NULL)
     {
-        std::map<uint256, CMutableTransaction>::const_iterator mdwi = mDenomWtxes.find(hash);
-        if (mdwi == mDenomWtxes.end()) {
-            // not known yet, let's add it
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds INSERTING %s\n", hash.ToString());
-            mDenomWtxes[hash] = CMutableTransaction(*wtx);
-        } else if(mDenomWtxes[hash].vout[nout].nRounds != -10) {
-            // found and it's not an initial value, just return it
-            return mDenomWtxes[hash].vout[nout].nRounds;
+        std::map<COutPoint, int>::const_iterator mori = mapOutpointRounds.find(outpoint);
+        if (mori != mapOutpointRounds.end()) {
+            // found, just return it
+            return mori->second;
         }
 
-
         // bounds check
         if (nout >= wtx->vout.size()) {
             // should never actually hit this
@@ -1270,16 +1356,12 @@ int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRo
         }
 
         if (CPrivateSend::IsCollateralAmount(wtx->vout[nout].nValue)) {
-            mDenomWtxes[hash].vout[nout].nRounds = -3;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+            return SetOutpointPrivateSendRounds(outpoint, -3);
         }
 
         //make sure the final output is non-denominate
         if (!CPrivateSend::IsDenominatedAmount(wtx->vout[nout].nValue)) { //NOT DENOM
-            mDenomWtxes[hash].vout[nout].nRounds = -2;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+            return SetOutpointPrivateSendRounds(outpoint, -2);
         }
 
         bool fAllDenoms = true;
@@ -1289,9 +1371,7 @@ int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRo
 
         // this one is denominated but there is another non-denominated output found in the same tx
         if (!fAllDenoms) {
-            mDenomWtxes[hash].vout[nout].nRounds = 0;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+            return SetOutpointPrivateSendRounds(outpoint, 0);
         }
 
         int nShortest = -10; // an initial value, should be no way to get this by calculations
@@ -1307,11 +1387,9 @@ int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRo
                 }
             }
         }
-        mDenomWtxes[hash].vout[nout].nRounds = fDenomFound
+        return SetOutpointPrivateSendRounds(outpoint, fDenomFound
                 ? (nShortest >= 15 ? 16 : nShortest + 1) // good, we a +1 to the shortest one but only 16 rounds max allowed
-                : 0;            // too bad, we are the fist one in that chain
-        LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-        return mDenomWtxes[hash].vout[nout].nRounds;
+                : 0);            // too bad, we are the fist one in that chain
     }
 
     return nRounds - 1;
@@ -1782,6 +1860,27 @@ set<uint256> CWalletTx::GetConflicts() const
     return result;
 }
 
+void CWalletTx::MarkDirty()
+{
+    fCreditCached = false;
+    fAvailableCreditCached = false;
+    fImmatureCreditCached = false;
+    fAnonymizedCreditCached = false;
+    fDenomUnconfCreditCached = false;
+    fDenomConfCreditCached = false;
+    fWatchDebitCached = false;
+    fWatchCreditCached = false;
+    fAvailableWatchCreditCached = false;
+    fImmatureWatchCreditCached = false;
+    fDebitCached = false;
+    fChangeCached = false;
+
+    if (pwallet) {
+        pwallet->MarkBalanceDirty(GetHash());
+        pwallet->MarkWalletUTXODirty(GetHash());
+    }
+}
+
 CAmount CWalletTx::GetDebit(const isminefilter& filter) const
 {
     if (vin.empty())
@@ -2128,20 +2227,221 @@ void CWallet::ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman
  */
 
 
-CAmount CWallet::GetBalance() const
+CWalletBalances& CWalletBalances::operator+=(const CWalletBalances& b)
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
+    nBalance += b.nBalance;
+    nUnconfirmedBalance += b.nUnconfirmedBalance;
+    nImmatureBalance += b.nImmatureBalance;
+    nWatchOnlyBalance += b.nWatchOnlyBalance;
+    nUnconfirmedWatchOnlyBalance += b.nUnconfirmedWatchOnlyBalance;
+    nImmatureWatchOnlyBalance += b.nImmatureWatchOnlyBalance;
+    nAnonymizedBalance += b.nAnonymizedBalance;
+    nDenominatedConfirmedBalance += b.nDenominatedConfirmedBalance;
+    nDenominatedUnconfirmedBalance += b.nDenominatedUnconfirmedBalance;
+    return *this;
+}
+
+CWalletBalances& CWalletBalances::operator-=(const CWalletBalances& b)
+{
+    nBalance -= b.nBalance;
+    nUnconfirmedBalance -= b.nUnconfirmedBalance;
+    nImmatureBalance -= b.nImmatureBalance;
+    nWatchOnlyBalance -= b.nWatchOnlyBalance;
+    nUnconfirmedWatchOnlyBalance -= b.nUnconfirmedWatchOnlyBalance;
+    nImmatureWatchOnlyBalance -= b.nImmatureWatchOnlyBalance;
+    nAnonymizedBalance -= b.nAnonymizedBalance;
+    nDenominatedConfirmedBalance -= b.nDenominatedConfirmedBalance;
+    nDenominatedUnconfirmedBalance -= b.nDenominatedUnconfirmedBalance;
+    return *this;
+}
+
+bool operator==(const CWalletBalances& a, const CWalletBalances& b)
+{
+    return a.nBalance == b.nBalance &&
+           a.nUnconfirmedBalance == b.nUnconfirmedBalance &&
+           a.nImmatureBalance == b.nImmatureBalance &&
+           a.nWatchOnlyBalance == b.nWatchOnlyBalance &&
+           a.nUnconfirmedWatchOnlyBalance == b.nUnconfirmedWatchOnlyBalance &&
+           a.nImmatureWatchOnlyBalance == b.nImmatureWatchOnlyBalance &&
+           a.nAnonymizedBalance == b.nAnonymizedBalance &&
+           a.nDenominatedConfirmedBalance == b.nDenominatedConfirmedBalance &&
+           a.nDenominatedUnconfirmedBalance == b.nDenominatedUnconfirmedBalance;
+}
+
+std::string CWalletBalances::ToString() const
+{
+    return strprintf("CWalletBalances(balance=%s, unconfirmed=%s, immature=%s, watchonly=%s/%s/%s, anonymized=%s, denominated=%s/%s)",
+        FormatMoney(nBalance), FormatMoney(nUnconfirmedBalance), FormatMoney(nImmatureBalance),
+        FormatMoney(nWatchOnlyBalance), FormatMoney(nUnconfirmedWatchOnlyBalance), FormatMoney(nImmatureWatchOnlyBalance),
+        FormatMoney(nAnonymizedBalance), FormatMoney(nDenominatedConfirmedBalance), FormatMoney(nDenominatedUnconfirmedBalance));
+}
+
+void CWallet::MarkBalanceDirty(const uint256& hash) const
+{
+    if (!fBalancesRebuild)
+        setBalanceDirty.insert(hash);
+}
+
+CWalletBalances CWallet::GetBalanceItem(const CWalletTx& wtx) const
+{
+    CWalletBalances item;
+
+    bool fTrusted = wtx.IsTrusted();
+    bool fUnconfirmed = !fTrusted && wtx.GetDepthInMainChain() == 0 && wtx.InMempool();
+
+    if (fTrusted) {
+        item.nBalance = wtx.GetAvailableCredit();
+        item.nWatchOnlyBalance = wtx.GetAvailableWatchOnlyCredit();
+    } else if (fUnconfirmed) {
+        item.nUnconfirmedBalance = wtx.GetAvailableCredit();
+        item.nUnconfirmedWatchOnlyBalance = wtx.GetAvailableWatchOnlyCredit();
+    }
+    item.nImmatureBalance = wtx.GetImmatureCredit();
+    item.nImmatureWatchOnlyBalance = wtx.GetImmatureWatchOnlyCredit();
+
+    if (!fLiteMode) {
+        if (fTrusted)
+            item.nAnonymizedBalance = wtx.GetAnonymizedCredit();
+        item.nDenominatedConfirmedBalance = wtx.GetDenominatedCredit(false);
+        item.nDenominatedUnconfirmedBalance = wtx.GetDenominatedCredit(true);
+    }
+
+    return item;
+}
+
+void CWallet::UpdateBalanceItem(const uint256& hash) const
+{
+    std::map<uint256, CWalletBalances>::iterator itItem = mapBalanceItems.find(hash);
+    if (itItem != mapBalanceItems.end()) {
+        balancesTotal -= itItem->second;
+        mapBalanceItems.erase(itItem);
+    }
+    setBalanceVolatile.erase(hash);
+
+    map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+    if (it == mapWallet.end())
+        return;
+    const CWalletTx& wtx = it->second;
+
+    CWalletBalances item = GetBalanceItem(wtx);
+    if (item != CWalletBalances()) {
+        balancesTotal += item;
+        mapBalanceItems.insert(std::make_pair(hash, item));
+    }
+
+    // Mempool membership, InstantSend locks and conflicts change without the
+    // tx itself being touched, keep re-checking these. A confirmed coinbase
+    // only changes once it matures, unless its block gets disconnected.
+    if (wtx.GetDepthInMainChain(false) < 1)
+        setBalanceVolatile.insert(hash);
+    else if (wtx.GetBlocksToMaturity() > 0)
+        mapBalanceMaturity.insert(std::make_pair(chainActive.Height() + wtx.GetBlocksToMaturity(), hash));
+}
+
+void CWallet::UpdateBalances() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    if (nBalancesPrivateSendRounds != privateSendClient.nPrivateSendRounds)
+        fBalancesRebuild = true;
+
+    // A reorg moves coinbase maturity both ways, which the maturity queue can't follow
+    if (pindexBalances != NULL && !chainActive.Contains(pindexBalances))
+        fBalancesRebuild = true;
+
+    if (fBalancesRebuild) {
+        mapBalanceItems.clear();
+        balancesTotal.SetNull();
+        setBalanceDirty.clear();
+        setBalanceVolatile.clear();
+        mapBalanceMaturity.clear();
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableCredit();
+            UpdateBalanceItem(it->first);
+        fBalancesRebuild = false;
+        nBalancesPrivateSendRounds = privateSendClient.nPrivateSendRounds;
+    } else {
+        std::set<uint256> setDirty;
+        setDirty.swap(setBalanceDirty);
+        BOOST_FOREACH(const uint256& hash, setDirty)
+            UpdateBalanceItem(hash);
+        std::vector<uint256> vVolatile(setBalanceVolatile.begin(), setBalanceVolatile.end());
+        BOOST_FOREACH(const uint256& hash, vVolatile)
+            if (!setDirty.count(hash))
+                UpdateBalanceItem(hash);
+        // entries of txes updated since they were queued are stale, updating them again is harmless
+        while (!mapBalanceMaturity.empty() && mapBalanceMaturity.begin()->first <= chainActive.Height()) {
+            uint256 hash = mapBalanceMaturity.begin()->second;
+            mapBalanceMaturity.erase(mapBalanceMaturity.begin());
+            UpdateBalanceItem(hash);
         }
     }
+    pindexBalances = chainActive.Tip();
 
-    return nTotal;
+    if (fCheckWalletBalances) {
+        CWalletBalances balancesFullScan = GetBalancesFullScan();
+        if (balancesFullScan != balancesTotal) {
+            LogPrintf("CWallet::%s -- balance accumulators %s do not match full scan %s\n", __func__,
+                    balancesTotal.ToString(), balancesFullScan.ToString());
+            assert(balancesFullScan == balancesTotal);
+        }
+    }
+}
+
+CWalletBalances CWallet::GetBalancesFullScan() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    CWalletBalances balances;
+
+    for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+    {
+        const CWalletTx* pcoin = &(*it).second;
+        if (pcoin->IsTrusted()) {
+            balances.nBalance += pcoin->GetAvailableCredit();
+            balances.nWatchOnlyBalance += pcoin->GetAvailableWatchOnlyCredit();
+        }
+        if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool()) {
+            balances.nUnconfirmedBalance += pcoin->GetAvailableCredit();
+            balances.nUnconfirmedWatchOnlyBalance += pcoin->GetAvailableWatchOnlyCredit();
+        }
+        balances.nImmatureBalance += pcoin->GetImmatureCredit();
+        balances.nImmatureWatchOnlyBalance += pcoin->GetImmatureWatchOnlyCredit();
+        if (!fLiteMode) {
+            balances.nDenominatedConfirmedBalance += pcoin->GetDenominatedCredit(false);
+            balances.nDenominatedUnconfirmedBalance += pcoin->GetDenominatedCredit(true);
+        }
+    }
+
+    if (!fLiteMode) {
+        UpdateWalletUTXO();
+        std::set<uint256> setWalletTxesCounted;
+        for (auto& outpoint : setWalletUTXO) {
+
+            if (setWalletTxesCounted.find(outpoint.hash) != setWalletTxesCounted.end()) continue;
+            setWalletTxesCounted.insert(outpoint.hash);
+
+            for (map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash); it != mapWallet.end() && it->first == outpoint.hash; ++it) {
+                if (it->second.IsTrusted())
+                    balances.nAnonymizedBalance += it->second.GetAnonymizedCredit();
+            }
+        }
+    }
+
+    return balances;
+}
+
+CWalletBalances CWallet::GetBalances() const
+{
+    LOCK2(cs_main, cs_wallet);
+    UpdateBalances();
+    return balancesTotal;
+}
+
+CAmount CWallet::GetBalance() const
+{
+    return GetBalances().nBalance;
 }
 
 CAmount CWallet::GetAnonymizableBalance(bool fSkipDenominated, bool fSkipUnconfirmed) const
@@ -2170,23 +2470,7 @@ CAmount CWallet::GetAnonymizedBalance() const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-
-    LOCK2(cs_main, cs_wallet);
-
-    std::set<uint256> setWalletTxesCounted;
-    for (auto& outpoint : setWalletUTXO) {
-
-        if (setWalletTxesCounted.find(outpoint.hash) != setWalletTxesCounted.end()) continue;
-        setWalletTxesCounted.insert(outpoint.hash);
-
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash); it != mapWallet.end() && it->first == outpoint.hash; ++it) {
-            if (it->second.IsTrusted())
-                nTotal += it->second.GetAnonymizedCredit();
-        }
-    }
-
-    return nTotal;
+    return GetBalances().nAnonymizedBalance;
 }
 
 // Note: calculated including unconfirmed,
@@ -2199,6 +2483,7 @@ float CWallet::GetAverageAnonymizedRounds() const
     int nCount = 0;
 
     LOCK2(cs_main, cs_wallet);
+    UpdateWalletUTXO();
     for (auto& outpoint : setWalletUTXO) {
         if(!IsDenominated(outpoint)) continue;
 
@@ -2220,6 +2505,7 @@ CAmount CWallet::GetNormalizedAnonymizedBalance() const
     CAmount nTotal = 0;
 
     LOCK2(cs_main, cs_wallet);
+    UpdateWalletUTXO();
     for (auto& outpoint : setWalletUTXO) {
         map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
         if (it == mapWallet.end()) continue;
@@ -2261,104 +2547,177 @@ CAmount CWallet::GetDenominatedBalance(bool unconfirmed) const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-
-            nTotal += pcoin->GetDenominatedCredit(unconfirmed);
-        }
-    }
-
-    return nTotal;
+    CWalletBalances balances = GetBalances();
+    return unconfirmed ? balances.nDenominatedUnconfirmedBalance : balances.nDenominatedConfirmedBalance;
 }
 
 CAmount CWallet::GetUnconfirmedBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nUnconfirmedBalance;
 }
 
 CAmount CWallet::GetImmatureBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nImmatureBalance;
 }
 
 CAmount CWallet::GetWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-
-    return nTotal;
+    return GetBalances().nWatchOnlyBalance;
 }
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
+    return GetBalances().nUnconfirmedWatchOnlyBalance;
+}
+
+CAmount CWallet::GetImmatureWatchOnlyBalance() const
+{
+    return GetBalances().nImmatureWatchOnlyBalance;
+}
+
+void CWallet::AddToWalletUTXO(const COutPoint& outpoint, CAmount nValue) const
+{
+    setWalletUTXO.insert(outpoint);
+    mapWalletUTXOByValue[nValue].insert(outpoint);
+    if (!fLiteMode && CPrivateSend::IsDenominatedAmount(nValue)) {
+        int nRounds = GetRealOutpointPrivateSendRounds(outpoint, 0);
+        mapWalletUTXORounds[outpoint] = nRounds;
+        mapWalletUTXOByRounds[nRounds].insert(outpoint);
+    }
+}
+
+void CWallet::EraseFromWalletUTXO(const COutPoint& outpoint, CAmount nValue) const
+{
+    if (!setWalletUTXO.erase(outpoint))
+        return;
+
+    std::map<CAmount, std::set<COutPoint> >::iterator itValue = mapWalletUTXOByValue.find(nValue);
+    if (itValue != mapWalletUTXOByValue.end()) {
+        itValue->second.erase(outpoint);
+        if (itValue->second.empty())
+            mapWalletUTXOByValue.erase(itValue);
+    }
+
+    std::map<COutPoint, int>::iterator itRounds = mapWalletUTXORounds.find(outpoint);
+    if (itRounds != mapWalletUTXORounds.end()) {
+        std::map<int, std::set<COutPoint> >::iterator itBucket = mapWalletUTXOByRounds.find(itRounds->second);
+        if (itBucket != mapWalletUTXOByRounds.end()) {
+            itBucket->second.erase(outpoint);
+            if (itBucket->second.empty())
+                mapWalletUTXOByRounds.erase(itBucket);
         }
+        mapWalletUTXORounds.erase(itRounds);
     }
-    return nTotal;
 }
 
-CAmount CWallet::GetImmatureWatchOnlyBalance() const
+void CWallet::MarkWalletUTXODirty(const uint256& hash) const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureWatchOnlyCredit();
+    setWalletUTXODirty.insert(hash);
+}
+
+void CWallet::UpdateWalletUTXO() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    if (setWalletUTXODirty.empty())
+        return;
+
+    std::set<uint256> setDirty;
+    setDirty.swap(setWalletUTXODirty);
+
+    BOOST_FOREACH(const uint256& hash, setDirty) {
+        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+        if (it == mapWallet.end())
+            continue;
+        const CWalletTx& wtx = it->second;
+        for (unsigned int i = 0; i < wtx.vout.size(); i++) {
+            COutPoint outpoint(hash, i);
+            EraseFromWalletUTXO(outpoint, wtx.vout[i].nValue);
+            if (IsMine(wtx.vout[i]) != ISMINE_NO && !IsSpent(hash, i))
+                AddToWalletUTXO(outpoint, wtx.vout[i].nValue);
         }
     }
-    return nTotal;
+}
+
+void CWallet::AppendWalletUTXOByValue(std::vector<COutPoint>& vOutpoints, CAmount nValueMin, CAmount nValueMax) const
+{
+    std::map<CAmount, std::set<COutPoint> >::const_iterator it = mapWalletUTXOByValue.lower_bound(nValueMin);
+    for (; it != mapWalletUTXOByValue.end() && it->first <= nValueMax; ++it)
+        vOutpoints.insert(vOutpoints.end(), it->second.begin(), it->second.end());
 }
 
 void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue, AvailableCoinsType nCoinType, bool fUseInstantSend) const
 {
     vCoins.clear();
 
+    LOCK2(cs_main, cs_wallet);
+    UpdateWalletUTXO();
+
+    std::vector<COutPoint> vOutpoints;
+    if(nCoinType == ONLY_DENOMINATED) {
+        BOOST_FOREACH(CAmount nDenomValue, CPrivateSend::GetStandardDenominations())
+            AppendWalletUTXOByValue(vOutpoints, nDenomValue, nDenomValue);
+    } else if(nCoinType == ONLY_1000) {
+        AppendWalletUTXOByValue(vOutpoints, 1000*COIN, 1000*COIN);
+    } else if(nCoinType == ONLY_PRIVATESEND_COLLATERAL) {
+        AppendWalletUTXOByValue(vOutpoints, CPrivateSend::GetCollateralAmount() + 1, CPrivateSend::GetMaxCollateralAmount());
+    } else {
+        vOutpoints.assign(setWalletUTXO.begin(), setWalletUTXO.end());
+    }
+
+    AvailableCoinsFromOutpoints(vCoins, vOutpoints, fOnlyConfirmed, coinControl, fIncludeZeroValue, nCoinType, fUseInstantSend);
+}
+
+void CWallet::AvailableDenominatedCoins(vector<COutput>& vCoins, int nPrivateSendRoundsMin, int nPrivateSendRoundsMax) const
+{
+    vCoins.clear();
+
+    LOCK2(cs_main, cs_wallet);
+    UpdateWalletUTXO();
+
+    // The index holds real rounds while callers compare rounds capped at the
+    // current setting, so a max above that setting can't rule anything out.
+    std::map<int, std::set<COutPoint> >::const_iterator itBegin = mapWalletUTXOByRounds.lower_bound(nPrivateSendRoundsMin);
+    std::map<int, std::set<COutPoint> >::const_iterator itEnd = mapWalletUTXOByRounds.end();
+    if (nPrivateSendRoundsMax <= privateSendClient.nPrivateSendRounds) {
+        if (nPrivateSendRoundsMax <= nPrivateSendRoundsMin)
+            return;
+        itEnd = mapWalletUTXOByRounds.lower_bound(nPrivateSendRoundsMax);
+    }
+
+    std::vector<COutPoint> vOutpoints;
+    for (std::map<int, std::set<COutPoint> >::const_iterator it = itBegin; it != itEnd; ++it)
+        vOutpoints.insert(vOutpoints.end(), it->second.begin(), it->second.end());
+
+    AvailableCoinsFromOutpoints(vCoins, vOutpoints, true, NULL, false, ONLY_DENOMINATED, false);
+}
+
+void CWallet::AvailableCoinsFromOutpoints(vector<COutput>& vCoins, vector<COutPoint>& vOutpoints, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue, AvailableCoinsType nCoinType, bool fUseInstantSend) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    // keep the mapWallet order of the full scan, and check each tx only once
+    std::sort(vOutpoints.begin(), vOutpoints.end());
+
+    const CWalletTx* pcoin = NULL;
+    bool fSkipTx = false;
+    int nDepth = 0;
+    BOOST_FOREACH(const COutPoint& outpoint, vOutpoints)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+        const uint256& wtxid = outpoint.hash;
+        unsigned int i = outpoint.n;
+
+        if (pcoin == NULL || pcoin->GetHash() != wtxid) {
+            std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(wtxid);
+            if (it == mapWallet.end()) {
+                pcoin = NULL;
+                continue;
+            }
+            pcoin = &(*it).second;
+            fSkipTx = true;
 
             if (!CheckFinalTx(*pcoin))
                 continue;
@@ -2369,7 +2728,7 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
             if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
                 continue;
 
-            int nDepth = pcoin->GetDepthInMainChain(false);
+            nDepth = pcoin->GetDepthInMainChain(false);
             // do not use IX for inputs that have less then INSTANTSEND_CONFIRMATIONS_REQUIRED blockchain confirmations
             if (fUseInstantSend && nDepth < INSTANTSEND_CONFIRMATIONS_REQUIRED)
                 continue;
@@ -2379,33 +2738,35 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
             if (nDepth == 0 && !pcoin->InMempool())
                 continue;
 
-            for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
-                bool found = false;
-                if(nCoinType == ONLY_DENOMINATED) {
-                    found = CPrivateSend::IsDenominatedAmount(pcoin->vout[i].nValue);
-                } else if(nCoinType == ONLY_NONDENOMINATED) {
-                    if (CPrivateSend::IsCollateralAmount(pcoin->vout[i].nValue)) continue; // do not use collateral amounts
-                    found = !CPrivateSend::IsDenominatedAmount(pcoin->vout[i].nValue);
-                } else if(nCoinType == ONLY_1000) {
-                    found = pcoin->vout[i].nValue == 1000*COIN;
-                } else if(nCoinType == ONLY_PRIVATESEND_COLLATERAL) {
-                    found = CPrivateSend::IsCollateralAmount(pcoin->vout[i].nValue);
-                } else {
-                    found = true;
-                }
-                if(!found) continue;
-
-                isminetype mine = IsMine(pcoin->vout[i]);
-                if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    (!IsLockedCoin((*it).first, i) || nCoinType == ONLY_1000) &&
-                    (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i))))
-                        vCoins.push_back(COutput(pcoin, i, nDepth,
-                                                 ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
-                                                  (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
-                                                 (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
-            }
+            fSkipTx = false;
+        }
+        if (fSkipTx || i >= pcoin->vout.size())
+            continue;
+
+        bool found = false;
+        if(nCoinType == ONLY_DENOMINATED) {
+            found = CPrivateSend::IsDenominatedAmount(pcoin->vout[i].nValue);
+        } else if(nCoinType == ONLY_NONDENOMINATED) {
+            if (CPrivateSend::IsCollateralAmount(pcoin->vout[i].nValue)) continue; // do not use collateral amounts
+            found = !CPrivateSend::IsDenominatedAmount(pcoin->vout[i].nValue);
+        } else if(nCoinType == ONLY_1000) {
+            found = pcoin->vout[i].nValue == 1000*COIN;
+        } else if(nCoinType == ONLY_PRIVATESEND_COLLATERAL) {
+            found = CPrivateSend::IsCollateralAmount(pcoin->vout[i].nValue);
+        } else {
+            found = true;
         }
+        if(!found) continue;
+
+        isminetype mine = IsMine(pcoin->vout[i]);
+        if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
+            (!IsLockedCoin(wtxid, i) || nCoinType == ONLY_1000) &&
+            (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
+            (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(outpoint)))
+                vCoins.push_back(COutput(pcoin, i, nDepth,
+                                         ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
+                                          (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
+                                         (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
     }
 }
 
@@ -2755,7 +3116,7 @@ bool CWallet::SelectCoinsByDenominations(int nDenom, CAmount nValueMin, CAmount
     nValueRet = 0;
 
     vector<COutput> vCoins;
-    AvailableCoins(vCoins, true, NULL, false, ONLY_DENOMINATED);
+    AvailableDenominatedCoins(vCoins, nPrivateSendRoundsMin, nPrivateSendRoundsMax);
 
     std::random_shuffle(vCoins.rbegin(), vCoins.rend(), GetRandInt);
 
@@ -2841,6 +3202,7 @@ bool CWallet::SelectCoinsGrouppedByAddresses(std::vector<CompactTallyItem>& vecT
     // Tally
     map<CTxDestination, CompactTallyItem> mapTally;
     std::set<uint256> setWalletTxesCounted;
+    UpdateWalletUTXO();
     for (auto& outpoint : setWalletUTXO) {
 
         if (setWalletTxesCounted.find(outpoint.hash) != setWalletTxesCounted.end()) continue;
@@ -2923,7 +3285,10 @@ bool CWallet::SelectCoinsDark(CAmount nValueMin, CAmount nValueMax, std::vector<
     nValueRet = 0;
 
     vector<COutput> vCoins;
-    AvailableCoins(vCoins, true, coinControl, false, nPrivateSendRoundsMin < 0 ? ONLY_NONDENOMINATED : ONLY_DENOMINATED);
+    if (nPrivateSendRoundsMin < 0)
+        AvailableCoins(vCoins, true, coinControl, false, ONLY_NONDENOMINATED);
+    else
+        AvailableDenominatedCoins(vCoins, nPrivateSendRoundsMin, nPrivateSendRoundsMax);
 
     //order the array so largest nondenom are first, then denominations, then very small inputs.
     sort(vCoins.rbegin(), vCoins.rend(), CompareByPriority());
@@ -3613,14 +3978,10 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
     }
 
     {
-        LOCK2(cs_main, cs_wallet);
-        for (auto& pair : mapWallet) {
-            for(int i = 0; i < pair.second.vout.size(); ++i) {
-                if (IsMine(pair.second.vout[i]) && !IsSpent(pair.first, i)) {
-                    setWalletUTXO.insert(COutPoint(pair.first, i));
-                }
-            }
-        }
+        LOCK(cs_wallet);
+        // the unspent output index is built on first use
+        for (auto& pair : mapWallet)
+            setWalletUTXODirty.insert(pair.first);
     }
 
     if (nLoadWalletRet != DB_LOAD_OK)
@@ -40,6 +40,7 @@ extern CAmount maxTxFee;
 extern unsigned int nTxConfirmTarget;
 extern bool bSpendZeroConfChange;
 extern bool fSendFreeTransactions;
+extern bool fCheckWalletBalances;
 
 static const unsigned int DEFAULT_KEYPOOL_SIZE = 1000;
 //! -paytxfee default
@@ -58,6 +59,8 @@ static const CAmount MIN_CHANGE = CENT;
 static const bool DEFAULT_SPEND_ZEROCONF_CHANGE = true;
 //! Default for -sendfreetransactions
 static const bool DEFAULT_SEND_FREE_TRANSACTIONS = false;
+//! Default for -checkwalletbalances
+static const bool DEFAULT_CHECK_WALLET_BALANCES = false;
 //! -txconfirmtarget default
 static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 2;
 //! -maxtxfee will warn if called with a higher fee than this amount (in satoshis)
@@ -259,6 +262,48 @@ public:
     void setAbandoned() { hashBlock = ABANDON_HASH; }
 };
 
+/**
+ * Wallet balances, either the contribution of a single transaction or the
+ * sum over the whole wallet (see CWallet::GetBalances)
+ */
+struct CWalletBalances
+{
+    CAmount nBalance;
+    CAmount nUnconfirmedBalance;
+    CAmount nImmatureBalance;
+    CAmount nWatchOnlyBalance;
+    CAmount nUnconfirmedWatchOnlyBalance;
+    CAmount nImmatureWatchOnlyBalance;
+    CAmount nAnonymizedBalance;
+    CAmount nDenominatedConfirmedBalance;
+    CAmount nDenominatedUnconfirmedBalance;
+
+    CWalletBalances()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        nBalance = 0;
+        nUnconfirmedBalance = 0;
+        nImmatureBalance = 0;
+        nWatchOnlyBalance = 0;
+        nUnconfirmedWatchOnlyBalance = 0;
+        nImmatureWatchOnlyBalance = 0;
+        nAnonymizedBalance = 0;
+        nDenominatedConfirmedBalance = 0;
+        nDenominatedUnconfirmedBalance = 0;
+    }
+
+    CWalletBalances& operator+=(const CWalletBalances& b);
+    CWalletBalances& operator-=(const CWalletBalances& b);
+    friend bool operator==(const CWalletBalances& a, const CWalletBalances& b);
+    friend bool operator!=(const CWalletBalances& a, const CWalletBalances& b) { return !(a == b); }
+
+    std::string ToString() const;
+};
+
 /** 
  * A transaction with a bunch of additional info that only the owner cares about.
  * It includes any unrecorded transactions needed to link it back to the block chain.
@@ -406,21 +451,7 @@ public:
     }
 
     //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        fCreditCached = false;
-        fAvailableCreditCached = false;
-        fImmatureCreditCached = false;
-        fAnonymizedCreditCached = false;
-        fDenomUnconfCreditCached = false;
-        fDenomConfCreditCached = false;
-        fWatchDebitCached = false;
-        fWatchCreditCached = false;
-        fAvailableWatchCreditCached = false;
-        fImmatureWatchCreditCached = false;
-        fDebitCached = false;
-        fChangeCached = false;
-    }
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -632,6 +663,46 @@ private:
     mutable bool fAnonymizableTallyCachedNonDenom;
     mutable std::vector<CompactTallyItem> vecAnonymizableTallyCachedNonDenom;
 
+    /**
+     * Balance accumulators. Every wallet tx contributes mapBalanceItems[hash]
+     * to balancesTotal. Contributions are recomputed only for txes marked
+     * dirty (see CWalletTx::MarkDirty), for not yet confirmed txes whose
+     * contribution can change without any wallet event (mempool, InstantSend
+     * locks, conflicts) and for immature coinbases once the chain reaches the
+     * height they mature at. Everything is recomputed after CWallet::MarkDirty,
+     * a reorg or when the PrivateSend rounds setting changes.
+     */
+    mutable std::map<uint256, CWalletBalances> mapBalanceItems;
+    mutable CWalletBalances balancesTotal;
+    mutable std::set<uint256> setBalanceDirty;
+    mutable std::set<uint256> setBalanceVolatile;
+    mutable std::multimap<int, uint256> mapBalanceMaturity;
+    mutable const CBlockIndex* pindexBalances;
+    mutable bool fBalancesRebuild;
+    mutable int nBalancesPrivateSendRounds;
+
+    CWalletBalances GetBalanceItem(const CWalletTx& wtx) const;
+    void UpdateBalanceItem(const uint256& hash) const;
+    void UpdateBalances() const;
+    //! The old full scan over mapWallet, used to verify the accumulators with -checkwalletbalances
+    CWalletBalances GetBalancesFullScan() const;
+
+    /**
+     * PrivateSend rounds of wallet outpoints, kept in the wallet db as
+     * "psrounds" records so mixing depth is only walked once per outpoint.
+     * New values are queued in setOutpointRoundsUnsaved until AddToWallet or
+     * Flush writes them out. Rounds of spent outpoints are kept, an output whose
+     * spender gets abandoned or conflicted is unspent again with its rounds known.
+     */
+    mutable std::map<COutPoint, int> mapOutpointRounds;
+    mutable std::set<COutPoint> setOutpointRoundsUnsaved;
+
+    int SetOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds) const;
+    void WriteOutpointPrivateSendRounds(CWalletDB* pwalletdb);
+    void ErasePrivateSendRounds(const COutPoint& outpoint, CWalletDB* pwalletdb);
+    /* Drop cached rounds of in-wallet txes spending hash (and their descendants). */
+    void EraseSpendersPrivateSendRounds(const uint256& hash, CWalletDB* pwalletdb);
+
     /**
      * Used to keep track of spent outpoints, and
      * detect and report conflicts (double-spends or
@@ -642,7 +713,27 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
-    std::set<COutPoint> setWalletUTXO;
+    /**
+     * Index of wallet outputs that are mine and not spent, so coin selection
+     * scales with the number of unspent outputs instead of the tx history.
+     * Txes whose outputs may have changed state are queued in
+     * setWalletUTXODirty (see CWalletTx::MarkDirty and AddToSpends) and
+     * re-evaluated by UpdateWalletUTXO before the index is read.
+     * Secondary indexes: by output value, and by (uncapped) PrivateSend
+     * rounds for denominated outputs.
+     */
+    mutable std::set<COutPoint> setWalletUTXO;
+    mutable std::map<CAmount, std::set<COutPoint> > mapWalletUTXOByValue;
+    mutable std::map<int, std::set<COutPoint> > mapWalletUTXOByRounds;
+    mutable std::map<COutPoint, int> mapWalletUTXORounds;
+    mutable std::set<uint256> setWalletUTXODirty;
+
+    void AddToWalletUTXO(const COutPoint& outpoint, CAmount nValue) const;
+    void EraseFromWalletUTXO(const COutPoint& outpoint, CAmount nValue) const;
+    void UpdateWalletUTXO() const;
+    void AppendWalletUTXOByValue(std::vector<COutPoint>& vOutpoints, CAmount nValueMin, CAmount nValueMax) const;
+    //! AvailableCoins checks for the given candidate outpoints
+    void AvailableCoinsFromOutpoints(std::vector<COutput>& vCoins, std::vector<COutPoint>& vOutpoints, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue, AvailableCoinsType nCoinType, bool fUseInstantSend) const;
 
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
@@ -724,6 +815,9 @@ public:
         fAnonymizableTallyCachedNonDenom = false;
         vecAnonymizableTallyCached.clear();
         vecAnonymizableTallyCachedNonDenom.clear();
+        pindexBalances = NULL;
+        fBalancesRebuild = true;
+        nBalancesPrivateSendRounds = 0;
     }
 
     std::map<uint256, CWalletTx> mapWallet;
@@ -756,6 +850,11 @@ public:
      * populate vCoins with vector of available COutputs.
      */
     void AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed=true, const CCoinControl *coinControl = NULL, bool fIncludeZeroValue=false, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = false) const;
+    /**
+     * populate vCoins with confirmed denominated COutputs with
+     * nPrivateSendRoundsMin <= rounds < nPrivateSendRoundsMax, the same way AvailableCoins would.
+     */
+    void AvailableDenominatedCoins(std::vector<COutput>& vCoins, int nPrivateSendRoundsMin, int nPrivateSendRoundsMax) const;
 
     /**
      * Shuffle and select coins until nTargetValue is reached while avoiding
@@ -784,6 +883,8 @@ public:
     int GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds) const;
     // respect current settings
     int GetOutpointPrivateSendRounds(const COutPoint& outpoint) const;
+    //! Load cached PrivateSend rounds (used by LoadWallet)
+    void LoadPrivateSendRounds(const COutPoint& outpoint, int nRounds);
 
     bool IsDenominated(const COutPoint& outpoint) const;
 
@@ -861,6 +962,12 @@ public:
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman);
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime, CConnman* connman);
+    //! Queue the balance contribution of a wallet tx for recalculation
+    void MarkBalanceDirty(const uint256& hash) const;
+    //! Queue the outputs of a wallet tx for re-evaluation in the unspent output index
+    void MarkWalletUTXODirty(const uint256& hash) const;
+    //! All balances at once, only txes that changed since the last call are looked at
+    CWalletBalances GetBalances() const;
     CAmount GetBalance() const;
     CAmount GetUnconfirmedBalance() const;
     CAmount GetImmatureBalance() const;
@@ -631,6 +631,14 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
                 return false;
             }
         }
+        else if (strType == "psrounds")
+        {
+            COutPoint outpoint;
+            ssKey >> outpoint;
+            int nRounds;
+            ssValue >> nRounds;
+            pwallet->LoadPrivateSendRounds(outpoint, nRounds);
+        }
     } catch (...)
     {
         return false;
@@ -1188,3 +1196,20 @@ bool CWalletDB::WriteHDPubKey(const CHDPubKey& hdPubKey, const CKeyMetadata& key
 
     return Write(std::make_pair(std::string("hdpubkey"), hdPubKey.extPubKey.pubkey), hdPubKey, false);
 }
+
+bool CWalletDB::ReadPrivateSendRounds(const COutPoint& outpoint, int& nRounds)
+{
+    return Read(std::make_pair(std::string("psrounds"), outpoint), nRounds);
+}
+
+bool CWalletDB::WritePrivateSendRounds(const COutPoint& outpoint, int nRounds)
+{
+    nWalletDBUpdated++;
+    return Write(std::make_pair(std::string("psrounds"), outpoint), nRounds);
+}
+
+bool CWalletDB::ErasePrivateSendRounds(const COutPoint& outpoint)
+{
+    nWalletDBUpdated++;
+    return Erase(std::make_pair(std::string("psrounds"), outpoint));
+}
@@ -24,6 +24,7 @@ class CAccountingEntry;
 struct CBlockLocator;
 class CKeyPool;
 class CMasterKey;
+class COutPoint;
 class CScript;
 class CWallet;
 class CWalletTx;
@@ -139,6 +140,11 @@ public:
     bool WriteCryptedHDChain(const CHDChain& chain);
     bool WriteHDPubKey(const CHDPubKey& hdPubKey, const CKeyMetadata& keyMeta);
 
+    //! read/write/erase the cached PrivateSend rounds of a wallet outpoint
+    bool ReadPrivateSendRounds(const COutPoint& outpoint, int& nRounds);
+    bool WritePrivateSendRounds(const COutPoint& outpoint, int nRounds);
+    bool ErasePrivateSendRounds(const COutPoint& outpoint);
+
 private:
     CWalletDB(const CWalletDB&);
     void operator=(const CWalletDB&);